@@ -0,0 +1,335 @@
+#pragma once
+
+#include "uze/core/serialize_deserialize.h"
+#include <algorithm>
+#include <type_traits>
+
+// Compact binary format, opt-in alternative to BinarySerializer:
+// integers are LEB128 varints (signed ones zig-zag encoded first), sizes are varints,
+// arrays of integers are encoded in chunks so they're written and read in bulk.
+// Types without a compact specialization fall back to BinarySerializer.
+
+namespace uze::compact
+{
+
+	constexpr u64 max_varint_size = 10;
+	constexpr u64 values_per_chunk = 4096;
+
+	constexpr u64 zigzagEncode(i64 value)
+	{
+		return (static_cast<u64>(value) << 1) ^ static_cast<u64>(value >> 63);
+	}
+
+	constexpr i64 zigzagDecode(u64 value)
+	{
+		return static_cast<i64>(value >> 1) ^ -static_cast<i64>(value & 1);
+	}
+
+	inline u8* encodeVarint(u64 value, u8* out)
+	{
+		while (value >= 0x80)
+		{
+			*out++ = static_cast<u8>(value) | 0x80;
+			value >>= 7;
+		}
+		*out++ = static_cast<u8>(value);
+		return out;
+	}
+
+	// Returns nullptr on truncated or malformed input
+	inline const u8* decodeVarint(const u8* in, const u8* end, u64& value)
+	{
+		value = 0;
+		for (u32 shift = 0; shift < 64 && in != end; shift += 7)
+		{
+			const u8 byte = *in++;
+			value |= static_cast<u64>(byte & 0x7f) << shift;
+			if (!(byte & 0x80))
+				return in;
+		}
+		return nullptr;
+	}
+
+	inline void writeVarint(std::ostream& o, u64 value)
+	{
+		u8 bytes[max_varint_size];
+		const u8* end = encodeVarint(value, bytes);
+		o.write(reinterpret_cast<const char*>(bytes), end - bytes);
+	}
+
+	inline u64 readVarint(std::istream& i)
+	{
+		u64 value = 0;
+		for (u32 shift = 0; shift < 64; shift += 7)
+		{
+			const auto byte = i.get();
+			if (byte == std::istream::traits_type::eof())
+				break;
+
+			value |= static_cast<u64>(byte & 0x7f) << shift;
+			if (!(byte & 0x80))
+				return value;
+		}
+		i.setstate(std::ios::failbit);
+		return 0;
+	}
+
+	template <class T>
+	constexpr bool is_varint_v = (std::is_integral_v<T> && !std::is_same_v<T, bool>) || std::is_enum_v<T>;
+
+	template <class T>
+	constexpr u64 toVarint(T value)
+	{
+		if constexpr (std::is_enum_v<T>)
+			return toVarint(static_cast<std::underlying_type_t<T>>(value));
+		else if constexpr (std::is_signed_v<T>)
+			return zigzagEncode(static_cast<i64>(value));
+		else
+			return static_cast<u64>(value);
+	}
+
+	template <class T>
+	constexpr T fromVarint(u64 value)
+	{
+		if constexpr (std::is_enum_v<T>)
+			return static_cast<T>(fromVarint<std::underlying_type_t<T>>(value));
+		else if constexpr (std::is_signed_v<T>)
+			return static_cast<T>(zigzagDecode(value));
+		else
+			return static_cast<T>(value);
+	}
+
+	// Deltas are taken on the two's complement values before the zig-zag encoding,
+	// so sorted signed arrays stay small when they cross zero
+	template <class T>
+	constexpr u64 toDeltaValue(T value)
+	{
+		if constexpr (std::is_enum_v<T>)
+			return toDeltaValue(static_cast<std::underlying_type_t<T>>(value));
+		else if constexpr (std::is_signed_v<T>)
+			return static_cast<u64>(static_cast<i64>(value));
+		else
+			return static_cast<u64>(value);
+	}
+
+	template <class T>
+	constexpr T fromDeltaValue(u64 value)
+	{
+		if constexpr (std::is_enum_v<T>)
+			return static_cast<T>(fromDeltaValue<std::underlying_type_t<T>>(value));
+		else
+			return static_cast<T>(value);
+	}
+
+	// Every chunk is a varint byte size followed by up to values_per_chunk varints.
+	// With `delta` each value is stored as the zig-zag encoded difference to the previous one,
+	// which takes one or two bytes per value for sorted ids and indices.
+	template <class T>
+	void writeIntegerArray(std::ostream& o, const T* data, u64 count, bool delta)
+	{
+		static_assert(is_varint_v<T>);
+
+		std::vector<u8> chunk(std::min(count, values_per_chunk) * max_varint_size);
+		u64 previous = 0;
+		for (u64 first = 0; first < count; first += values_per_chunk)
+		{
+			const u64 last = std::min(first + values_per_chunk, count);
+			u8* out = chunk.data();
+			for (u64 n = first; n < last; ++n)
+			{
+				if (delta)
+				{
+					const u64 value = toDeltaValue(data[n]);
+					out = encodeVarint(zigzagEncode(static_cast<i64>(value - previous)), out);
+					previous = value;
+				}
+				else
+				{
+					out = encodeVarint(toVarint(data[n]), out);
+				}
+			}
+
+			const u64 size = static_cast<u64>(out - chunk.data());
+			writeVarint(o, size);
+			o.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(size));
+		}
+	}
+
+	// Reads one chunk of at most values_per_chunk values
+	template <class T>
+	bool readIntegerChunk(std::istream& i, T* data, u64 count, bool delta, u64& previous, std::vector<u8>& chunk)
+	{
+		const u64 size = readVarint(i);
+		if (!i || size > count * max_varint_size)
+		{
+			i.setstate(std::ios::failbit);
+			return false;
+		}
+
+		chunk.resize(size);
+		i.read(reinterpret_cast<char*>(chunk.data()), static_cast<std::streamsize>(size));
+		if (!i)
+			return false;
+
+		const u8* in = chunk.data();
+		const u8* end = in + size;
+		for (u64 n = 0; n < count; ++n)
+		{
+			u64 value;
+			in = in ? decodeVarint(in, end, value) : nullptr;
+			if (!in)
+			{
+				i.setstate(std::ios::failbit);
+				return false;
+			}
+
+			if (delta)
+			{
+				previous += static_cast<u64>(zigzagDecode(value));
+				data[n] = fromDeltaValue<T>(previous);
+			}
+			else
+			{
+				data[n] = fromVarint<T>(value);
+			}
+		}
+		return true;
+	}
+
+	template <class T>
+	void readIntegerArray(std::istream& i, T* data, u64 count, bool delta)
+	{
+		static_assert(is_varint_v<T>);
+
+		std::vector<u8> chunk;
+		u64 previous = 0;
+		for (u64 first = 0; first < count; first += values_per_chunk)
+		{
+			if (!readIntegerChunk(i, data + first, std::min(values_per_chunk, count - first), delta, previous, chunk))
+				return;
+		}
+	}
+
+	// The count comes from the stream and isn't trusted: the vector grows one chunk at a time,
+	// so truncated or malformed input fails on the missing data instead of allocating the claimed size
+	template <class T>
+	void readIntegerArray(std::istream& i, std::vector<T>& v, u64 count, bool delta)
+	{
+		static_assert(is_varint_v<T>);
+
+		v.clear();
+		std::vector<u8> chunk;
+		u64 previous = 0;
+		for (u64 first = 0; first < count; first += values_per_chunk)
+		{
+			const u64 num_values = std::min(values_per_chunk, count - first);
+			v.resize(first + num_values);
+			if (!readIntegerChunk(i, v.data() + first, num_values, delta, previous, chunk))
+				return;
+		}
+	}
+
+	template <class T>
+	void writeDeltaArray(std::ostream& o, const std::vector<T>& v)
+	{
+		writeVarint(o, v.size());
+		writeIntegerArray(o, v.data(), v.size(), true);
+	}
+
+	template <class T>
+	void readDeltaArray(std::istream& i, std::vector<T>& v)
+	{
+		const u64 size = readVarint(i);
+		if (!i) return;
+		readIntegerArray(i, v, size, true);
+	}
+
+}
+
+template <class T>
+struct CompactBinarySerializer
+{
+	void operator()(std::ostream& o, const T& obj) const
+	{
+		if constexpr (uze::compact::is_varint_v<T>)
+			uze::compact::writeVarint(o, uze::compact::toVarint(obj));
+		else
+			BinarySerializer<T>{}(o, obj);
+	}
+};
+
+template <class T>
+struct CompactBinaryDeserializer
+{
+	void operator()(std::istream& i, T& obj) const
+	{
+		if constexpr (uze::compact::is_varint_v<T>)
+			obj = uze::compact::fromVarint<T>(uze::compact::readVarint(i));
+		else
+			BinaryDeserializer<T>{}(i, obj);
+	}
+};
+
+template <>
+struct CompactBinarySerializer<std::string>
+{
+	void operator()(std::ostream& o, const std::string& s) const
+	{
+		uze::compact::writeVarint(o, s.size());
+		o.write(s.data(), s.size());
+	}
+};
+
+template <>
+struct CompactBinaryDeserializer<std::string>
+{
+	void operator()(std::istream& i, std::string& s) const
+	{
+		const uze::u64 size = uze::compact::readVarint(i);
+		if (!i) return;
+		uze::readRawBinaryBounded(i, s, size);
+	}
+};
+
+template <class T>
+struct CompactBinarySerializer<std::vector<T>>
+{
+	void operator()(std::ostream& o, const std::vector<T>& v) const
+	{
+		uze::compact::writeVarint(o, v.size());
+		if constexpr (uze::compact::is_varint_v<T>)
+		{
+			uze::compact::writeIntegerArray(o, v.data(), v.size(), false);
+		}
+		else
+		{
+			for (const auto& e : v)
+			{
+				CompactBinarySerializer<T>{}(o, e);
+			}
+		}
+	}
+};
+
+template <class T>
+struct CompactBinaryDeserializer<std::vector<T>>
+{
+	void operator()(std::istream& i, std::vector<T>& v) const
+	{
+		const uze::u64 size = uze::compact::readVarint(i);
+		if (!i) return;
+		if constexpr (uze::compact::is_varint_v<T>)
+		{
+			uze::compact::readIntegerArray(i, v, size, false);
+		}
+		else
+		{
+			// Grows with the elements actually read, the size isn't trusted
+			v.clear();
+			for (uze::u64 n = 0; n < size && i; ++n)
+			{
+				CompactBinaryDeserializer<T>{}(i, v.emplace_back());
+			}
+		}
+	}
+};
@@ -8,8 +8,38 @@ namespace uze
 	namespace fs
 	{
 
+		class MappedFile;
+		UZE MappedFile mapFile(std::string_view file);
+
+		// Read-only view of a whole file. On desktop the file is mapped into memory,
+		// so pages are loaded lazily and shared between processes mapping the same file
+		class UZE MappedFile final : NonCopyable<MappedFile>
+		{
+		public:
+
+			MappedFile() = default;
+			MappedFile(MappedFile&& other) noexcept;
+			MappedFile& operator=(MappedFile&& other) noexcept;
+			~MappedFile();
+
+			const u8* data() const { return m_data; }
+			u64 size() const { return m_size; }
+
+			explicit operator bool() const { return m_data; }
+
+		private:
+
+			const u8* m_data{ nullptr };
+			u64 m_size{ 0 };
+			void* m_handle{ nullptr };
+
+			void release();
+
+			friend MappedFile mapFile(std::string_view file);
+		};
+
 		UZE Buffer getFileContents(std::string_view file);
 
 	}
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,283 @@
+#pragma once
+
+#include "uze/common.h"
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Flat serialized format which is read in place, without a parse step.
+// Objects are trivially copyable structs, instead of pointers they store offsets relative
+// to the offset field itself, so a buffer may be loaded at any address
+// (e.g. fs::mapFile) and shared between processes. Data is stored in native byte order.
+//
+//	struct Level
+//	{
+//		flat::String name;
+//		flat::Vector<glm::vec2> vertices;
+//	};
+//
+//	flat::Builder builder;
+//	auto level = builder.create<Level>();
+//	builder.setString(level, &Level::name, "Level 1");
+//	builder.setVector(level, &Level::vertices, vertices.data(), vertices.size());
+//	if (builder.finish(level))
+//		builder.write(out);
+//
+//	auto file = fs::mapFile("level.bin");
+//	const Level* l = flat::getRoot<Level>(file.data(), file.size());
+
+namespace uze::flat
+{
+
+	constexpr u32 magic = 0x42465a55; // "UZFB"
+	constexpr u32 format_version = 1;
+	constexpr u64 max_alignment = 16;
+	// Offsets are i32 and the size in the header is u32
+	constexpr u64 max_size = 0x7fffffff;
+
+	struct Header
+	{
+		u32 magic;
+		u32 version;
+		u32 size;
+		u32 root;
+	};
+
+	template <class T>
+	struct Ref
+	{
+		i32 offset{ 0 };
+
+		const T* get() const
+		{
+			return offset ? reinterpret_cast<const T*>(reinterpret_cast<const u8*>(this) + offset) : nullptr;
+		}
+
+		const T* operator->() const { return get(); }
+		const T& operator*() const { return *get(); }
+		explicit operator bool() const { return offset; }
+	};
+
+	template <class T>
+	struct Vector
+	{
+		i32 offset{ 0 };
+		u32 count{ 0 };
+
+		const T* data() const
+		{
+			return count ? reinterpret_cast<const T*>(reinterpret_cast<const u8*>(this) + offset) : nullptr;
+		}
+
+		u32 size() const { return count; }
+		bool empty() const { return count == 0; }
+
+		const T* begin() const { return data(); }
+		const T* end() const { return data() + count; }
+		const T& operator[](u32 index) const { return data()[index]; }
+	};
+
+	struct String
+	{
+		// Stored with a null terminator which isn't included in size()
+		Vector<char> chars;
+
+		std::string_view view() const { return { chars.data(), chars.size() }; }
+		const char* c_str() const { return chars.empty() ? "" : chars.data(); }
+		u32 size() const { return chars.size(); }
+		bool empty() const { return chars.empty(); }
+	};
+
+	// Position of an object inside of a Builder, stays valid while the builder grows
+	template <class T>
+	struct Handle
+	{
+		u64 position{ 0 };
+
+		Handle<T> operator[](u64 index) const { return { position + index * sizeof(T) }; }
+	};
+
+	class Builder final : NonCopyable<Builder>
+	{
+	public:
+
+		Builder()
+		{
+			m_data.resize(sizeof(Header));
+		}
+
+		template <class T>
+		Handle<T> create(const T& value = T{})
+		{
+			checkType<T>();
+			const auto position = allocate(sizeof(T), alignof(T));
+			std::memcpy(m_data.data() + position, &value, sizeof(T));
+			return { position };
+		}
+
+		// Allocates zeroed array elements which can be filled with at() afterwards
+		template <class T, class U>
+		Handle<U> createVector(Handle<T> object, Vector<U> T::* member, u64 count)
+		{
+			checkType<U>();
+			const auto position = allocate(sizeof(U) * count, alignof(U));
+			link(fieldPosition(object, member), position, static_cast<u32>(count));
+			return { position };
+		}
+
+		template <class T, class U>
+		void setVector(Handle<T> object, Vector<U> T::* member, const U* data, u64 count)
+		{
+			const auto elements = createVector(object, member, count);
+			if (count)
+				std::memcpy(m_data.data() + elements.position, data, sizeof(U) * count);
+		}
+
+		template <class T>
+		void setString(Handle<T> object, String T::* member, std::string_view str)
+		{
+			const auto position = allocate(str.size() + 1, alignof(char));
+			std::memcpy(m_data.data() + position, str.data(), str.size());
+			link(fieldPosition(object, member), position, static_cast<u32>(str.size()));
+		}
+
+		template <class T, class U>
+		void setRef(Handle<T> object, Ref<U> T::* member, Handle<U> target)
+		{
+			const auto field = fieldPosition(object, member);
+			const i32 offset = static_cast<i32>(static_cast<i64>(target.position) - static_cast<i64>(field));
+			std::memcpy(m_data.data() + field, &offset, sizeof(offset));
+		}
+
+		// Reference is invalidated by the next allocation
+		template <class T>
+		T& at(Handle<T> object)
+		{
+			return *reinterpret_cast<T*>(m_data.data() + object.position);
+		}
+
+		// Fails when the buffer is larger than max_size, the header isn't written then
+		template <class T>
+		bool finish(Handle<T> root)
+		{
+			if (m_data.size() > max_size)
+				return false;
+
+			Header header{ magic, format_version, static_cast<u32>(m_data.size()), static_cast<u32>(root.position) };
+			std::memcpy(m_data.data(), &header, sizeof(Header));
+			return true;
+		}
+
+		const u8* data() const { return m_data.data(); }
+		u64 size() const { return m_data.size(); }
+
+		void write(std::ostream& o) const
+		{
+			o.write(reinterpret_cast<const char*>(m_data.data()), static_cast<std::streamsize>(m_data.size()));
+		}
+
+	private:
+
+		std::vector<u8> m_data;
+
+		template <class T>
+		static constexpr void checkType()
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "flat types must be trivially copyable");
+			static_assert(alignof(T) <= max_alignment, "flat types can't be aligned stricter than flat::max_alignment");
+		}
+
+		u64 allocate(u64 size, u64 alignment)
+		{
+			const u64 position = (m_data.size() + alignment - 1) & ~(alignment - 1);
+			m_data.resize(position + size);
+			return position;
+		}
+
+		template <class T, class Member>
+		u64 fieldPosition(Handle<T> object, Member T::* member)
+		{
+			return static_cast<u64>(reinterpret_cast<const u8*>(&(at(object).*member)) - m_data.data());
+		}
+
+		void link(u64 field, u64 target, u32 count)
+		{
+			const i32 offset = static_cast<i32>(static_cast<i64>(target) - static_cast<i64>(field));
+			std::memcpy(m_data.data() + field, &offset, sizeof(offset));
+			std::memcpy(m_data.data() + field + sizeof(offset), &count, sizeof(count));
+		}
+	};
+
+	// Data has to be aligned to max_alignment, which is the case for mapped files and
+	// buffers from fs::getFileContents. Only the header and the bounds and alignment of the root are checked,
+	// offsets inside of the buffer have to be checked with a Verifier unless the data is trusted
+	template <class T>
+	const T* getRoot(const u8* data, u64 size)
+	{
+		if (!data || size < sizeof(Header) || reinterpret_cast<std::uintptr_t>(data) % alignof(T) != 0)
+			return nullptr;
+
+		Header header;
+		std::memcpy(&header, data, sizeof(Header));
+		if (header.magic != magic || header.version != format_version || header.size > size
+			|| static_cast<u64>(header.root) + sizeof(T) > header.size || header.root % alignof(T) != 0)
+			return nullptr;
+
+		return reinterpret_cast<const T*>(data + header.root);
+	}
+
+	// Bounds checks for untrusted buffers (downloaded, user supplied or modded files).
+	// Every Ref, Vector and String is checked before it's followed:
+	//
+	//	const Level* l = flat::getRoot<Level>(file.data(), file.size());
+	//	flat::Verifier verifier(file.data(), file.size());
+	//	if (!l || !verifier.check(l->name) || !verifier.check(l->vertices))
+	//		return false;
+	class Verifier
+	{
+	public:
+
+		Verifier(const u8* data, u64 size) : m_data(data), m_size(size) {}
+
+		template <class T>
+		bool check(const Ref<T>& ref) const
+		{
+			return !ref || checkRange(&ref, ref.offset, sizeof(T), alignof(T));
+		}
+
+		template <class T>
+		bool check(const Vector<T>& v) const
+		{
+			return !v.count || checkRange(&v, v.offset, static_cast<u64>(v.count) * sizeof(T), alignof(T));
+		}
+
+		bool check(const String& s) const
+		{
+			// The null terminator has to be inside of the buffer as well
+			return s.chars.empty() || (checkRange(&s.chars, s.chars.offset, u64(s.chars.count) + 1, 1)
+				&& s.chars.data()[s.chars.count] == '\0');
+		}
+
+	private:
+
+		const u8* m_data;
+		u64 m_size;
+
+		// Positions are computed as integers, so bad offsets never form pointers outside of the buffer
+		bool checkRange(const void* field, i32 offset, u64 size, u64 alignment) const
+		{
+			const auto field_address = reinterpret_cast<std::uintptr_t>(field);
+			const auto data_address = reinterpret_cast<std::uintptr_t>(m_data);
+			if (field_address < data_address || field_address - data_address >= m_size)
+				return false;
+
+			const i64 position = static_cast<i64>(field_address - data_address) + offset;
+			return position >= 0 && static_cast<u64>(position) <= m_size
+				&& static_cast<u64>(position) % alignment == 0 && size <= m_size - static_cast<u64>(position);
+		}
+	};
+
+}
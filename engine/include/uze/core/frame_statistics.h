@@ -0,0 +1,98 @@
+#pragma once
+
+#include "uze/common.h"
+#include <array>
+#include <iosfwd>
+#include <vector>
+
+namespace uze
+{
+
+	struct UZE FrameTiming final
+	{
+		// Time between the ends of two consecutive frames, what the player actually sees
+		double frame_ms{ 0.0 };
+		// Frame time without waiting in swap
+		double cpu_ms{ 0.0 };
+		// GPU execution time. It's only known a few frames later, so it's zero in the newest frames
+		// and whenever it isn't measured, see FrameStatistics::setGpuTime
+		double gpu_ms{ 0.0 };
+		double swap_ms{ 0.0 };
+	};
+
+	enum class UZE FrameTimeComponent : u8
+	{
+		Frame, Cpu, Gpu, Swap
+	};
+
+	struct UZE FrameTimeSummary final
+	{
+		u64 num_frames{ 0 };
+		double min_ms{ 0.0 };
+		double average_ms{ 0.0 };
+		double p50_ms{ 0.0 };
+		double p95_ms{ 0.0 };
+		double p99_ms{ 0.0 };
+		double max_ms{ 0.0 };
+		u64 num_hitches{ 0 };
+	};
+
+	// Keeps timings of the last window_size frames for percentiles and a histogram of frame times
+	// over the whole run. A frame is a hitch when it takes hitch_factor times longer than the average
+	// of recent frames and at least hitch_min_ms
+	class UZE FrameStatistics final
+	{
+	public:
+
+		// Buckets are 1 ms wide, the last one counts all longer frames
+		static constexpr u64 num_histogram_buckets = 100;
+
+		explicit FrameStatistics(u64 window_size = 600);
+
+		void addFrame(const FrameTiming& timing);
+		// Fills in GPU time of a frame added earlier, frame_number is getNumFrames() before its addFrame.
+		// Ignored when the frame isn't in the window anymore
+		void setGpuTime(u64 frame_number, double gpu_ms);
+		void reset();
+
+		void setWindowSize(u64 window_size);
+		u64 getWindowSize() const { return m_frames.size(); }
+		void setHitchThreshold(double hitch_factor, double hitch_min_ms);
+
+		// Over the last num_frames frames of the window, the whole window by default
+		FrameTimeSummary getSummary(FrameTimeComponent component = FrameTimeComponent::Frame,
+			u64 num_frames = ~0ull) const;
+
+		const FrameTiming& getLastFrame() const;
+		u64 getNumFrames() const { return m_total_frames; }
+		u64 getNumHitches() const { return m_total_hitches; }
+		const std::array<u64, num_histogram_buckets>& getHistogram() const { return m_histogram; }
+
+		// One row per frame of the window, oldest first, followed by the histogram
+		bool writeCsv(std::ostream& out) const;
+
+	private:
+
+		struct Frame
+		{
+			FrameTiming timing;
+			bool hitch;
+		};
+
+		std::vector<Frame> m_frames;
+		u64 m_next{ 0 };
+		u64 m_count{ 0 };
+
+		u64 m_total_frames{ 0 };
+		u64 m_total_hitches{ 0 };
+		std::array<u64, num_histogram_buckets> m_histogram{};
+
+		double m_hitch_factor{ 2.0 };
+		double m_hitch_min_ms{ 20.0 };
+		double m_recent_average_ms{ 0.0 };
+
+		const Frame& getFrame(u64 age) const { return m_frames[(m_next + m_frames.size() - 1 - age) % m_frames.size()]; }
+
+	};
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "uze/types.h"
+#include <string_view>
+
+namespace uze
+{
+
+	constexpr u32 fnv1a32(std::string_view str)
+	{
+		u32 hash = 0x811c9dc5u;
+		for (const char c : str)
+		{
+			hash ^= static_cast<u8>(c);
+			hash *= 0x01000193u;
+		}
+		return hash;
+	}
+
+	constexpr u64 fnv1a64(std::string_view str)
+	{
+		u64 hash = 0xcbf29ce484222325ull;
+		for (const char c : str)
+		{
+			hash ^= static_cast<u8>(c);
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+}
@@ -39,6 +39,10 @@ namespace uze
 
 		UZE void waitForAllJobs();
 
+		// Calls func(index) for every index in [0, count) on worker threads and waits for all of them.
+		// The calling thread executes queued jobs while waiting. Runs serially if job system isn't initialized
+		UZE void parallelFor(u64 count, const std::function<void(u64)>& func);
+
 		UZE u64 getNumWorkerThreads();
 		UZE u64 getNumBusyWorkerThreads();
 
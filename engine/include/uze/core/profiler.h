@@ -0,0 +1,76 @@
+#pragma once
+
+#include "uze/common.h"
+#include <atomic>
+#include <iosfwd>
+#include <string_view>
+
+namespace uze
+{
+
+	UZE extern std::atomic<bool> uzProfile_capturing;
+
+	// CPU zones are recorded into lock-free per-thread buffers while a capture is running and exported
+	// as Chrome trace JSON, which chrome://tracing and ui.perfetto.dev open directly. Nesting is
+	// shown from the times of the zones. Outside of a capture a zone costs a single relaxed load
+	namespace profiler
+	{
+
+		// Nanoseconds of steady clock
+		inline u64 now()
+		{
+			return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count());
+		}
+
+		// Discards zones of the previous capture. Buffers of threads which haven't recorded a zone yet
+		// get events_per_thread entries, buffers are kept between captures
+		UZE void startCapture(u64 events_per_thread = 1 << 15);
+		UZE void stopCapture();
+		inline bool isCapturing() { return uzProfile_capturing.load(std::memory_order_relaxed); }
+
+		// Moves zones from per-thread buffers into the capture. Should be called regularly,
+		// e.g. once per frame, zones which don't fit into a full buffer are dropped
+		UZE void collect();
+		UZE u64 getNumDroppedZones();
+
+		// Collects the remaining zones, can be called during or after a capture
+		UZE bool writeChromeTrace(std::ostream& out);
+
+		// Name of the calling thread's track in the trace
+		UZE void setThreadName(std::string_view name);
+
+		// Name must stay valid until the trace is written, string literals are expected
+		UZE void recordZone(const char* name, u64 begin, u64 end);
+
+	}
+
+	class ProfileScope final : NonCopyable<ProfileScope>
+	{
+	public:
+
+		explicit ProfileScope(const char* name)
+			: m_name(profiler::isCapturing() ? name : nullptr), m_begin(m_name ? profiler::now() : 0) {}
+
+		~ProfileScope()
+		{
+			if (m_name)
+				profiler::recordZone(m_name, m_begin, profiler::now());
+		}
+
+	private:
+
+		const char* m_name;
+		u64 m_begin;
+
+	};
+
+}
+
+#if defined(UZE_DISABLE_PROFILING)
+#define UZE_PROFILE_SCOPE(name)
+#else
+#define UZE_PROFILE_SCOPE(name) const ::uze::ProfileScope UZE_CONCAT(uze_profile_scope_, __LINE__)(name)
+#endif
+
+#define UZE_PROFILE_FUNCTION() UZE_PROFILE_SCOPE(__func__)
@@ -1,29 +1,315 @@
 #pragma once
 
 #include "uze/common.h"
-#include <random>
+#include <cstring>
+#include <limits>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
 
 namespace uze
 {
 
-	class UZE Random
+	// Non-deterministic seed from std::random_device
+	UZE u64 makeRandomSeed();
+
+	// Used to expand a single seed into the state of the other generators,
+	// consecutive seeds still give unrelated states
+	struct SplitMix64
+	{
+		u64 state;
+
+		explicit constexpr SplitMix64(u64 seed = 0) : state(seed) {}
+
+		constexpr u64 nextU64()
+		{
+			u64 z = (state += 0x9e3779b97f4a7c15ull);
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+			return z ^ (z >> 31);
+		}
+
+		constexpr u32 nextU32() { return static_cast<u32>(nextU64() >> 32); }
+	};
+
+	// Seed of an independent stream derived from a master seed, e.g. keyed by job or entity index
+	constexpr u64 mixSeed(u64 seed, u64 key)
+	{
+		return SplitMix64(seed + SplitMix64(key).nextU64()).nextU64();
+	}
+
+	// xoshiro256**, 32 bytes of state, default generator of Random
+	class Xoshiro256StarStar
+	{
+	public:
+
+		explicit constexpr Xoshiro256StarStar(u64 seed = 0)
+		{
+			SplitMix64 seeder(seed);
+			for (auto& word : m_state)
+				word = seeder.nextU64();
+		}
+
+		constexpr u64 nextU64()
+		{
+			const u64 result = rotl(m_state[1] * 5, 7) * 9;
+			const u64 t = m_state[1] << 17;
+
+			m_state[2] ^= m_state[0];
+			m_state[3] ^= m_state[1];
+			m_state[1] ^= m_state[2];
+			m_state[0] ^= m_state[3];
+			m_state[2] ^= t;
+			m_state[3] = rotl(m_state[3], 45);
+
+			return result;
+		}
+
+		// Upper bits are the strongest ones
+		constexpr u32 nextU32() { return static_cast<u32>(nextU64() >> 32); }
+
+		// Same as 2^128 calls to nextU64, gives 2^128 non-overlapping sequences
+		constexpr void jump() { jump(jump_polynomial); }
+		// Same as 2^192 calls to nextU64, e.g. one long jump per thread and jump() per task of it
+		constexpr void longJump() { jump(long_jump_polynomial); }
+
+		static constexpr Xoshiro256StarStar forStream(u64 seed, u64 stream)
+		{
+			return Xoshiro256StarStar(mixSeed(seed, stream));
+		}
+
+	private:
+
+		static constexpr u64 jump_polynomial[4] = {
+			0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull, 0xa9582618e03fc9aaull, 0x39abdc4529b1661cull
+		};
+		static constexpr u64 long_jump_polynomial[4] = {
+			0x76e15d3efefdcbbfull, 0xc5004e441c522fb3ull, 0x77710069854ee241ull, 0x39109bb02acbe635ull
+		};
+
+		u64 m_state[4]{};
+
+		static constexpr u64 rotl(u64 x, i32 k) { return (x << k) | (x >> (64 - k)); }
+
+		constexpr void jump(const u64 (&polynomial)[4])
+		{
+			u64 state[4]{};
+			for (const u64 word : polynomial)
+			{
+				for (i32 bit = 0; bit < 64; ++bit)
+				{
+					if (word & (1ull << bit))
+					{
+						for (i32 n = 0; n < 4; ++n)
+							state[n] ^= m_state[n];
+					}
+					nextU64();
+				}
+			}
+			for (i32 n = 0; n < 4; ++n)
+				m_state[n] = state[n];
+		}
+
+	};
+
+	// PCG-XSH-RR with 64-bit state, 16 bytes including the stream, e.g. for per-entity generators
+	class Pcg32
 	{
 	public:
 
-		Random();
-		Random(u32 seed);
+		explicit constexpr Pcg32(u64 seed = 0, u64 stream = 0)
+			: m_increment((stream << 1) | 1)
+		{
+			nextU32();
+			m_state += SplitMix64(seed).nextU64();
+			nextU32();
+		}
+
+		constexpr u32 nextU32()
+		{
+			const u64 old_state = m_state;
+			m_state = old_state * pcg_multiplier + m_increment;
+			const auto xor_shifted = static_cast<u32>(((old_state >> 18) ^ old_state) >> 27);
+			const auto rotation = static_cast<u32>(old_state >> 59);
+			return (xor_shifted >> rotation) | (xor_shifted << ((32 - rotation) & 31));
+		}
 
-		i32 next();
-		i32 next(i32 max_value);
-		i32 next(i32 min_value, i32 max_value);
+		constexpr u64 nextU64()
+		{
+			const u64 high = nextU32();
+			return (high << 32) | nextU32();
+		}
 
-		float nextFloat();
-		float nextFloat(float min_value, float max_value);
+		// Same as delta calls to nextU32 in O(log delta) steps, delta can be "negative" to go back
+		constexpr void advance(u64 delta)
+		{
+			u64 multiplier = pcg_multiplier;
+			u64 increment = m_increment;
+			u64 total_multiplier = 1;
+			u64 total_increment = 0;
+			while (delta > 0)
+			{
+				if (delta & 1)
+				{
+					total_multiplier *= multiplier;
+					total_increment = total_increment * multiplier + increment;
+				}
+				increment *= multiplier + 1;
+				multiplier *= multiplier;
+				delta >>= 1;
+			}
+			m_state = m_state * total_multiplier + total_increment;
+		}
+
+		// Streams which differ only in the increment are correlated, so the state is seeded from
+		// the key as well. The increment keeps 63 bits of the key, keys differing only in the top bit
+		// still get different states
+		static constexpr Pcg32 forStream(u64 seed, u64 stream) { return Pcg32(mixSeed(seed, stream), stream); }
 
 	private:
 
-		std::mt19937 m_random_number_generator;
+		static constexpr u64 pcg_multiplier = 0x5851f42d4c957f2dull;
+
+		u64 m_state{ 0 };
+		u64 m_increment;
 
 	};
 
-}
\ No newline at end of file
+	// Generate many values at once from four xoshiro256** streams stepped together, with AVX2, SSE2
+	// or WASM SIMD when the build enables them. The random bits depend only on the seed, so every
+	// instruction set gives the same values. Gaussian, disc and sphere transforms run on the same
+	// vectors with polynomial log and sincos, absolute error is around 1e-6
+	namespace random_batch
+	{
+
+		// Uniform in [min_value, max_value)
+		UZE void fillUniform(u64 seed, float* values, u64 count, float min_value, float max_value);
+		UZE void fillGaussian(u64 seed, float* values, u64 count, float mean, float standard_deviation);
+		// Uniformly distributed over the area of the disc
+		UZE void fillInUnitDisc(u64 seed, glm::vec2* points, u64 count);
+		// Uniformly distributed over the surface of the sphere
+		UZE void fillOnUnitSphere(u64 seed, glm::vec3* points, u64 count);
+
+	}
+
+	template <class Generator>
+	class BasicRandom
+	{
+	public:
+
+		BasicRandom() : BasicRandom(makeRandomSeed()) {}
+		explicit BasicRandom(u64 seed) : m_generator(seed) {}
+		explicit BasicRandom(const Generator& generator) : m_generator(generator) {}
+
+		// In [0, i32 max]
+		i32 next() { return next(0, std::numeric_limits<i32>::max()); }
+		// In [0, max_value]
+		i32 next(i32 max_value) { return next(0, max_value); }
+		// In [min_value, max_value]
+		i32 next(i32 min_value, i32 max_value)
+		{
+			const u64 range = static_cast<u64>(static_cast<i64>(max_value) - min_value) + 1;
+			return static_cast<i32>(static_cast<i64>(min_value) + nextBounded(range));
+		}
+
+		// In [0, 1)
+		float nextFloat()
+		{
+			// 23 random bits as the mantissa of a float in [1, 2)
+			const u32 bits = 0x3f800000u | (m_generator.nextU32() >> 9);
+			float value;
+			std::memcpy(&value, &bits, sizeof(value));
+			return value - 1.0f;
+		}
+
+		// In [min_value, max_value)
+		float nextFloat(float min_value, float max_value)
+		{
+			return min_value + (max_value - min_value) * nextFloat();
+		}
+
+		// Batches take a single value of the generator as their seed
+		void fill(float* values, u64 count, float min_value = 0.0f, float max_value = 1.0f)
+		{
+			random_batch::fillUniform(nextU64(), values, count, min_value, max_value);
+		}
+
+		void fillGaussian(float* values, u64 count, float mean = 0.0f, float standard_deviation = 1.0f)
+		{
+			random_batch::fillGaussian(nextU64(), values, count, mean, standard_deviation);
+		}
+
+		void fillInUnitDisc(glm::vec2* points, u64 count) { random_batch::fillInUnitDisc(nextU64(), points, count); }
+		void fillOnUnitSphere(glm::vec3* points, u64 count) { random_batch::fillOnUnitSphere(nextU64(), points, count); }
+
+		u32 nextU32() { return m_generator.nextU32(); }
+		u64 nextU64() { return m_generator.nextU64(); }
+
+		// Independent generator seeded from this one, advances this one by two values
+		BasicRandom split()
+		{
+			const u64 seed = nextU64();
+			return BasicRandom(Generator::forStream(seed, nextU64()));
+		}
+
+		Generator& getGenerator() { return m_generator; }
+
+	private:
+
+		Generator m_generator;
+
+		// In [0, range), range is in [1, 2^32]. Lemire's multiply-shift, the division is only needed
+		// to reject the few values which would make the result biased
+		u64 nextBounded(u64 range)
+		{
+			if (range > std::numeric_limits<u32>::max())
+				return m_generator.nextU32();
+
+			const auto bound = static_cast<u32>(range);
+			u64 m = static_cast<u64>(m_generator.nextU32()) * bound;
+			auto low = static_cast<u32>(m);
+			if (low < bound)
+			{
+				const u32 threshold = (0u - bound) % bound;
+				while (low < threshold)
+				{
+					m = static_cast<u64>(m_generator.nextU32()) * bound;
+					low = static_cast<u32>(m);
+				}
+			}
+			return m >> 32;
+		}
+
+	};
+
+	using Random = BasicRandom<Xoshiro256StarStar>;
+	// Fits into 16 bytes
+	using CompactRandom = BasicRandom<Pcg32>;
+
+	// Deterministic generators for parallel work. A stream depends only on the master seed and its key,
+	// so keying by job, chunk or entity index gives the same values for any number of workers
+	// and any order they run in. Copying is free, nothing is shared between threads
+	template <class Generator>
+	class BasicRandomStreams
+	{
+	public:
+
+		explicit constexpr BasicRandomStreams(u64 seed) : m_seed(seed) {}
+
+		BasicRandom<Generator> get(u64 key) const { return BasicRandom<Generator>(Generator::forStream(m_seed, key)); }
+		// Seed for random_batch functions
+		constexpr u64 getSeed(u64 key) const { return mixSeed(m_seed, key); }
+		// Nested streams, e.g. per world chunk and then per entity in the chunk
+		constexpr BasicRandomStreams child(u64 key) const { return BasicRandomStreams(mixSeed(~m_seed, key)); }
+
+		constexpr u64 getMasterSeed() const { return m_seed; }
+
+	private:
+
+		u64 m_seed;
+
+	};
+
+	using RandomStreams = BasicRandomStreams<Xoshiro256StarStar>;
+	using CompactRandomStreams = BasicRandomStreams<Pcg32>;
+
+}
@@ -0,0 +1,357 @@
+#pragma once
+
+#include "uze/core/serialize_deserialize.h"
+#include "uze/core/tagged_serialize.h"
+#include "uze/core/compact_serialize.h"
+#include <entt/entity/registry.hpp>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace uze
+{
+
+	// Changes of a registry since the previous delta, recorded from construction, update and destruction
+	// signals of the pools of a RegistrySnapshot, see RegistrySnapshot::track and saveDelta.
+	// Has to be destroyed or stop tracking before the registry it tracks
+	class UZE RegistryBaseline final : NonCopyable<RegistryBaseline>
+	{
+	public:
+
+		RegistryBaseline() = default;
+		~RegistryBaseline() { stopTracking(); }
+
+		// The next delta contains the whole registry
+		void clear()
+		{
+			m_full = true;
+			for (const auto& pool : m_pools)
+				pool->dirty.clear();
+		}
+
+		void stopTracking()
+		{
+			for (auto& connection : m_connections)
+				connection.release();
+			m_connections.clear();
+			m_pools.clear();
+			m_registry = nullptr;
+			m_full = true;
+		}
+
+	private:
+
+		struct PoolState
+		{
+			// Entities whose component was constructed, updated or destroyed since the previous delta,
+			// unsorted and with duplicates
+			std::vector<entt::entity> dirty;
+		};
+
+		const entt::registry* m_registry{ nullptr };
+		// Listeners keep pointers to the states, so they never move
+		std::vector<std::unique_ptr<PoolState>> m_pools;
+		std::vector<entt::connection> m_connections;
+		bool m_full{ true };
+
+		static void markDirty(PoolState& state, entt::registry&, entt::entity entity)
+		{
+			state.dirty.push_back(entity);
+		}
+
+		friend class RegistrySnapshot;
+	};
+
+	// Saves and loads component pools of an entt::registry.
+	// Every registered pool is serialized into its own contiguous block on job system workers,
+	// trivially copyable components are copied in bulk. Loading recreates entities with
+	// their original identifiers and bulk-inserts every pool in parallel.
+	// Entities which have no registered components aren't saved.
+	//
+	//	RegistrySnapshot snapshot;
+	//	snapshot.component<TransformComponent>().component<SpriteRendererComponent>();
+	//	snapshot.save(registry, out);
+	class UZE RegistrySnapshot
+	{
+	public:
+
+		// Component type has to be reflected, pools are identified by hash of the type name
+		template <class T>
+		RegistrySnapshot& component();
+
+		void save(const entt::registry& registry, std::ostream& o) const;
+
+		// Replaces contents of the registry. Every pool is decoded before the registry is cleared,
+		// so it's left untouched when the snapshot is corrupted. Listeners of construction signals
+		// must be thread-safe, pools are filled concurrently
+		bool load(entt::registry& registry, std::istream& i) const;
+
+		// Records which components of the registered pools are constructed, updated or destroyed,
+		// so saveDelta only serializes those. Components modified in place through get or a view don't
+		// emit signals, they have to be changed with registry.patch or registry.replace to be in the next delta
+		void track(entt::registry& registry, RegistryBaseline& baseline) const;
+
+		// Writes components which were added, changed or removed since the previous delta and entities
+		// which were destroyed, so its cost scales with the number of changes instead of the size of the registry.
+		// The first delta after track or clear, and every delta of a baseline which doesn't track
+		// the registry, contain the whole registry
+		void saveDelta(const entt::registry& registry, RegistryBaseline& baseline, std::ostream& o) const;
+
+		// Applies a delta on top of the state it was computed from. Entities aren't destroyed
+		// when all of their components are removed, only when they were destroyed in the source registry.
+		// Entities of the target which occupy an index the source recycled are destroyed as well
+		bool loadDelta(entt::registry& registry, std::istream& i) const;
+
+	private:
+
+		struct Pool
+		{
+			u64 id;
+			void (*save)(const entt::registry&, std::vector<u8>&);
+			void (*prepare)(entt::registry&);
+			// Components of a block, null when they're corrupted
+			std::shared_ptr<void> (*decode)(u64, const u8*, u64);
+			void (*insert)(entt::registry&, const entt::entity*, u64, void*);
+			void (*track)(entt::registry&, RegistryBaseline::PoolState&, std::vector<entt::connection>&);
+			// Sorts the dirty entities, with `full` they're replaced by every entity of the pool
+			std::string (*saveChanges)(const entt::registry&, std::vector<entt::entity>&, bool);
+			bool (*applyDelta)(entt::registry&, const std::vector<entt::entity>&,
+				const std::vector<entt::entity>&, const u8*, u64);
+		};
+
+		std::vector<Pool> m_pools;
+
+		const Pool* findPool(u64 id) const;
+
+		template <class T>
+		static void savePool(const entt::registry& registry, std::vector<u8>& block);
+
+		template <class T>
+		static std::shared_ptr<void> decodePool(u64 count, const u8* data, u64 size);
+
+		template <class T>
+		static void insertPool(entt::registry& registry, const entt::entity* entities, u64 count, void* components);
+
+		template <class T>
+		static void trackPool(entt::registry& registry, RegistryBaseline::PoolState& state,
+			std::vector<entt::connection>& connections);
+
+		template <class T>
+		static std::string savePoolChanges(const entt::registry& registry, std::vector<entt::entity>& entities, bool full);
+
+		template <class T>
+		static bool applyPoolDelta(entt::registry& registry, const std::vector<entt::entity>& removed,
+			const std::vector<entt::entity>& changed, const u8* data, u64 size);
+
+	};
+
+	template <class T>
+	RegistrySnapshot& RegistrySnapshot::component()
+	{
+		Pool pool;
+		pool.id = tagged::getTypeHash<T>();
+		pool.save = &savePool<T>;
+		pool.prepare = [](entt::registry& registry) { registry.storage<T>(); };
+		pool.decode = &decodePool<T>;
+		pool.insert = &insertPool<T>;
+		pool.track = &trackPool<T>;
+		pool.saveChanges = &savePoolChanges<T>;
+		pool.applyDelta = &applyPoolDelta<T>;
+		m_pools.push_back(pool);
+		return *this;
+	}
+
+	// Block layout: u64 count | count entities | count components
+	template <class T>
+	void RegistrySnapshot::savePool(const entt::registry& registry, std::vector<u8>& block)
+	{
+		const auto view = registry.view<T>();
+		const u64 count = view.size();
+
+		const u64 components_size = std::is_empty_v<T> || !std::is_trivially_copyable_v<T> ? 0 : count * sizeof(T);
+		block.resize(sizeof(u64) + count * sizeof(entt::entity) + components_size);
+		std::memcpy(block.data(), &count, sizeof(u64));
+
+		u8* entities = block.data() + sizeof(u64);
+		if constexpr (std::is_empty_v<T>)
+		{
+			for (const auto entity : view)
+			{
+				std::memcpy(entities, &entity, sizeof(entt::entity));
+				entities += sizeof(entt::entity);
+			}
+		}
+		else if constexpr (std::is_trivially_copyable_v<T>)
+		{
+			u8* components = entities + count * sizeof(entt::entity);
+			for (auto [entity, component] : view.each())
+			{
+				std::memcpy(entities, &entity, sizeof(entt::entity));
+				std::memcpy(components, &component, sizeof(T));
+				entities += sizeof(entt::entity);
+				components += sizeof(T);
+			}
+		}
+		else
+		{
+			std::ostringstream o;
+			for (auto [entity, component] : view.each())
+			{
+				std::memcpy(entities, &entity, sizeof(entt::entity));
+				entities += sizeof(entt::entity);
+				BinarySerializer<T>{}(o, component);
+			}
+
+			const auto components = o.str();
+			block.insert(block.end(), components.begin(), components.end());
+		}
+	}
+
+	template <class T>
+	std::shared_ptr<void> RegistrySnapshot::decodePool(u64 count, const u8* data, u64 size)
+	{
+		auto components = std::make_shared<std::vector<T>>();
+		if constexpr (std::is_empty_v<T>)
+		{
+			if (size != 0)
+				return nullptr;
+		}
+		else if constexpr (std::is_trivially_copyable_v<T>)
+		{
+			if (size != count * sizeof(T))
+				return nullptr;
+
+			components->resize(count);
+			if (count)
+				std::memcpy(components->data(), data, size);
+		}
+		else
+		{
+			// Grows with the data actually read, count alone can't force a large allocation
+			MemoryInputStream i(data, size);
+			for (u64 n = 0; n < count; ++n)
+			{
+				BinaryDeserializer<T>{}(i, components->emplace_back());
+				if (!i)
+					return nullptr;
+			}
+		}
+		return components;
+	}
+
+	template <class T>
+	void RegistrySnapshot::insertPool(entt::registry& registry, const entt::entity* entities, u64 count, void* components)
+	{
+		if constexpr (std::is_empty_v<T>)
+			registry.insert<T>(entities, entities + count);
+		else
+			registry.insert<T>(entities, entities + count, static_cast<std::vector<T>*>(components)->begin());
+	}
+
+	template <class T>
+	void RegistrySnapshot::trackPool(entt::registry& registry, RegistryBaseline::PoolState& state,
+		std::vector<entt::connection>& connections)
+	{
+		connections.push_back(registry.on_construct<T>().template connect<&RegistryBaseline::markDirty>(state));
+		connections.push_back(registry.on_update<T>().template connect<&RegistryBaseline::markDirty>(state));
+		connections.push_back(registry.on_destroy<T>().template connect<&RegistryBaseline::markDirty>(state));
+	}
+
+	// Block layout: compact delta arrays of removed and changed entities | changed components.
+	// Empty when nothing changed
+	template <class T>
+	std::string RegistrySnapshot::savePoolChanges(const entt::registry& registry, std::vector<entt::entity>& entities,
+		bool full)
+	{
+		const auto view = registry.view<T>();
+		if (full)
+			entities.assign(view.begin(), view.end());
+		std::sort(entities.begin(), entities.end());
+		entities.erase(std::unique(entities.begin(), entities.end()), entities.end());
+
+		// Dirty entities which don't have the component anymore were removed, the rest were added or changed
+		std::vector<entt::entity> removed;
+		std::vector<entt::entity> changed;
+		for (const auto entity : entities)
+		{
+			if (registry.valid(entity) && view.contains(entity))
+				changed.push_back(entity);
+			else
+				removed.push_back(entity);
+		}
+
+		if (removed.empty() && changed.empty())
+			return {};
+
+		std::ostringstream o;
+		compact::writeDeltaArray(o, removed);
+		compact::writeDeltaArray(o, changed);
+		// Components of empty types aren't stored
+		if constexpr (std::is_trivially_copyable_v<T> && !std::is_empty_v<T>)
+		{
+			for (const auto entity : changed)
+			{
+				o.write(reinterpret_cast<const char*>(&view.template get<T>(entity)), sizeof(T));
+			}
+		}
+		else if constexpr (!std::is_empty_v<T>)
+		{
+			for (const auto entity : changed)
+			{
+				BinarySerializer<T>{}(o, view.template get<T>(entity));
+			}
+		}
+		return o.str();
+	}
+
+	template <class T>
+	bool RegistrySnapshot::applyPoolDelta(entt::registry& registry, const std::vector<entt::entity>& removed,
+		const std::vector<entt::entity>& changed, const u8* data, u64 size)
+	{
+		for (const auto entity : removed)
+		{
+			if (registry.valid(entity))
+				registry.remove<T>(entity);
+		}
+
+		if constexpr (std::is_empty_v<T>)
+		{
+			for (const auto entity : changed)
+			{
+				registry.emplace_or_replace<T>(entity);
+			}
+		}
+		else if constexpr (std::is_trivially_copyable_v<T>)
+		{
+			if (size != changed.size() * sizeof(T))
+				return false;
+
+			for (u64 n = 0; n < changed.size(); ++n)
+			{
+				T component;
+				std::memcpy(&component, data + n * sizeof(T), sizeof(T));
+				registry.emplace_or_replace<T>(changed[n], component);
+			}
+		}
+		else
+		{
+			MemoryInputStream i(data, size);
+			for (const auto entity : changed)
+			{
+				T component;
+				BinaryDeserializer<T>{}(i, component);
+				if (!i)
+					return false;
+
+				registry.emplace_or_replace<T>(entity, std::move(component));
+			}
+		}
+
+		return true;
+	}
+
+}
@@ -1,10 +1,21 @@
 #pragma once
 
 #include "uze/common.h"
+#include <algorithm>
+#include <array>
 #include <iostream>
+#include <map>
+#include <optional>
+#include <set>
 #include <string>
-#include <vector>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <glm/fwd.hpp>
+#include <entt/entity/fwd.hpp>
 
 template <class T>
 struct BinarySerializer
@@ -24,7 +35,13 @@ struct BinaryDeserializer
 	}
 };
 
+// Types which are serialized as their raw bytes, containers of them are read and written in bulk
+template <class T>
+struct IsRawBinarySerializable : std::false_type {};
+
 #define DEFAULT_SERIALIZER_DESERIALIZER(T) \
+	template <> struct IsRawBinarySerializable<T> : std::true_type {}; \
+	 \
 	template <> struct BinarySerializer<T> \
 	{ \
 		void operator()(std::ostream& o, const T& obj) const \
@@ -50,6 +67,160 @@ DEFAULT_SERIALIZER_DESERIALIZER(uze::u64);
 DEFAULT_SERIALIZER_DESERIALIZER(float);
 DEFAULT_SERIALIZER_DESERIALIZER(double);
 
+DEFAULT_SERIALIZER_DESERIALIZER(entt::entity);
+
+// Stored as a byte, any byte other than 0 reads as true. Bytes aren't read into a bool directly,
+// values other than 0 and 1 would be undefined behavior
+template <>
+struct BinarySerializer<bool>
+{
+	void operator()(std::ostream& o, const bool& obj) const
+	{
+		BinarySerializer<uze::u8>{}(o, obj ? 1 : 0);
+	}
+};
+
+template <>
+struct BinaryDeserializer<bool>
+{
+	void operator()(std::istream& i, bool& obj) const
+	{
+		uze::u8 value = 0;
+		BinaryDeserializer<uze::u8>{}(i, value);
+		obj = value != 0;
+	}
+};
+
+template <glm::length_t L, class T, glm::qualifier Q>
+struct IsRawBinarySerializable<glm::vec<L, T, Q>> : IsRawBinarySerializable<T> {};
+
+template <glm::length_t C, glm::length_t R, class T, glm::qualifier Q>
+struct IsRawBinarySerializable<glm::mat<C, R, T, Q>> : IsRawBinarySerializable<T> {};
+
+template <class T, glm::qualifier Q>
+struct IsRawBinarySerializable<glm::qua<T, Q>> : IsRawBinarySerializable<T> {};
+
+template <class T, std::size_t N>
+struct IsRawBinarySerializable<std::array<T, N>> : IsRawBinarySerializable<T> {};
+
+namespace uze
+{
+
+	template <class T>
+	void writeRawBinary(std::ostream& o, const T* data, u64 count)
+	{
+		o.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(count * sizeof(T)));
+	}
+
+	template <class T>
+	void readRawBinary(std::istream& i, T* data, u64 count)
+	{
+		i.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(count * sizeof(T)));
+	}
+
+	// Sizes read from a stream aren't trusted: containers reserve at most max_reserve_bytes up front
+	// and grow with the elements actually read, so corrupt input fails the stream instead of
+	// allocating (or throwing on) the claimed size
+	constexpr u64 max_reserve_bytes = 1 << 20;
+
+	template <class T>
+	constexpr u64 getBoundedReserve(u64 size)
+	{
+		return std::min<u64>(size, std::max<u64>(max_reserve_bytes / sizeof(T), 1));
+	}
+
+	// Resizes `c` to `count` raw binary elements read from the stream, in steps of max_reserve_bytes
+	template <class Container>
+	void readRawBinaryBounded(std::istream& i, Container& c, u64 count)
+	{
+		using T = typename Container::value_type;
+		constexpr u64 step = std::max<u64>(max_reserve_bytes / sizeof(T), 1);
+
+		c.clear();
+		for (u64 first = 0; first < count && i; first += step)
+		{
+			const u64 num_elements = std::min(step, count - first);
+			c.resize(first + num_elements);
+			readRawBinary(i, c.data() + first, num_elements);
+		}
+	}
+
+}
+
+template <glm::length_t L, class T, glm::qualifier Q>
+struct BinarySerializer<glm::vec<L, T, Q>>
+{
+	void operator()(std::ostream& o, const glm::vec<L, T, Q>& v) const
+	{
+		if constexpr (IsRawBinarySerializable<T>::value)
+		{
+			uze::writeRawBinary(o, &v, 1);
+		}
+		else
+		{
+			for (glm::length_t n = 0; n < L; ++n)
+			{
+				BinarySerializer<T>{}(o, v[n]);
+			}
+		}
+	}
+};
+
+template <glm::length_t L, class T, glm::qualifier Q>
+struct BinaryDeserializer<glm::vec<L, T, Q>>
+{
+	void operator()(std::istream& i, glm::vec<L, T, Q>& v) const
+	{
+		if constexpr (IsRawBinarySerializable<T>::value)
+		{
+			uze::readRawBinary(i, &v, 1);
+		}
+		else
+		{
+			for (glm::length_t n = 0; n < L; ++n)
+			{
+				BinaryDeserializer<T>{}(i, v[n]);
+			}
+		}
+	}
+};
+
+template <glm::length_t C, glm::length_t R, class T, glm::qualifier Q>
+struct BinarySerializer<glm::mat<C, R, T, Q>>
+{
+	void operator()(std::ostream& o, const glm::mat<C, R, T, Q>& m) const
+	{
+		uze::writeRawBinary(o, &m, 1);
+	}
+};
+
+template <glm::length_t C, glm::length_t R, class T, glm::qualifier Q>
+struct BinaryDeserializer<glm::mat<C, R, T, Q>>
+{
+	void operator()(std::istream& i, glm::mat<C, R, T, Q>& m) const
+	{
+		uze::readRawBinary(i, &m, 1);
+	}
+};
+
+template <class T, glm::qualifier Q>
+struct BinarySerializer<glm::qua<T, Q>>
+{
+	void operator()(std::ostream& o, const glm::qua<T, Q>& q) const
+	{
+		uze::writeRawBinary(o, &q, 1);
+	}
+};
+
+template <class T, glm::qualifier Q>
+struct BinaryDeserializer<glm::qua<T, Q>>
+{
+	void operator()(std::istream& i, glm::qua<T, Q>& q) const
+	{
+		uze::readRawBinary(i, &q, 1);
+	}
+};
+
 template <>
 struct BinarySerializer<std::string>
 {
@@ -65,10 +236,9 @@ struct BinaryDeserializer<std::string>
 {
 	void operator()(std::istream& i, std::string& s) const
 	{
-		std::string::size_type size;
+		std::string::size_type size = 0;
 		BinaryDeserializer<std::string::size_type>{}(i, size);
-		s.resize(size);
-		i.read(s.data(), size);
+		uze::readRawBinaryBounded(i, s, size);
 	}
 };
 
@@ -78,9 +248,16 @@ struct BinarySerializer<std::vector<T>>
 	void operator()(std::ostream& o, const std::vector<T>& v) const
 	{
 		BinarySerializer<typename std::vector<T>::size_type>{}(o, v.size());
-		for (const auto& e : v)
+		if constexpr (IsRawBinarySerializable<T>::value)
 		{
-			BinarySerializer<T>{}(o, e);
+			uze::writeRawBinary(o, v.data(), v.size());
+		}
+		else
+		{
+			for (const auto& e : v)
+			{
+				BinarySerializer<T>{}(o, e);
+			}
 		}
 	}
 };
@@ -90,13 +267,129 @@ struct BinaryDeserializer<std::vector<T>>
 {
 	void operator()(std::istream& i, std::vector<T>& v) const
 	{
-		typename std::vector<T>::size_type size;
+		typename std::vector<T>::size_type size = 0;
 		BinaryDeserializer<typename std::vector<T>::size_type>{}(i, size);
-		v.resize(size);
-		for (decltype(size) n = 0; n < size; ++n)
+		if constexpr (IsRawBinarySerializable<T>::value)
+		{
+			uze::readRawBinaryBounded(i, v, size);
+		}
+		else
+		{
+			v.clear();
+			v.reserve(uze::getBoundedReserve<T>(size));
+			for (decltype(size) n = 0; n < size && i; ++n)
+			{
+				T value{};
+				BinaryDeserializer<T>{}(i, value);
+				if (!i)
+					break;
+				v.push_back(std::move(value));
+			}
+		}
+	}
+};
+
+template <class T, std::size_t N>
+struct BinarySerializer<std::array<T, N>>
+{
+	void operator()(std::ostream& o, const std::array<T, N>& a) const
+	{
+		if constexpr (IsRawBinarySerializable<T>::value)
+		{
+			uze::writeRawBinary(o, a.data(), N);
+		}
+		else
+		{
+			for (const auto& e : a)
+			{
+				BinarySerializer<T>{}(o, e);
+			}
+		}
+	}
+};
+
+template <class T, std::size_t N>
+struct BinaryDeserializer<std::array<T, N>>
+{
+	void operator()(std::istream& i, std::array<T, N>& a) const
+	{
+		if constexpr (IsRawBinarySerializable<T>::value)
+		{
+			uze::readRawBinary(i, a.data(), N);
+		}
+		else
+		{
+			for (auto& e : a)
+			{
+				BinaryDeserializer<T>{}(i, e);
+			}
+		}
+	}
+};
+
+template <class T>
+struct BinarySerializer<std::optional<T>>
+{
+	void operator()(std::ostream& o, const std::optional<T>& opt) const
+	{
+		BinarySerializer<bool>{}(o, opt.has_value());
+		if (opt)
+			BinarySerializer<T>{}(o, *opt);
+	}
+};
+
+template <class T>
+struct BinaryDeserializer<std::optional<T>>
+{
+	void operator()(std::istream& i, std::optional<T>& opt) const
+	{
+		bool has_value = false;
+		BinaryDeserializer<bool>{}(i, has_value);
+		if (!has_value)
 		{
-			BinaryDeserializer<T>{}(i, v[n]);
+			opt.reset();
+			return;
 		}
+
+		BinaryDeserializer<T>{}(i, opt.emplace());
+	}
+};
+
+template <class A, class B>
+struct BinarySerializer<std::pair<A, B>>
+{
+	void operator()(std::ostream& o, const std::pair<A, B>& p) const
+	{
+		BinarySerializer<A>{}(o, p.first);
+		BinarySerializer<B>{}(o, p.second);
+	}
+};
+
+template <class A, class B>
+struct BinaryDeserializer<std::pair<A, B>>
+{
+	void operator()(std::istream& i, std::pair<A, B>& p) const
+	{
+		BinaryDeserializer<A>{}(i, p.first);
+		BinaryDeserializer<B>{}(i, p.second);
+	}
+};
+
+template <class... Ts>
+struct BinarySerializer<std::tuple<Ts...>>
+{
+	void operator()(std::ostream& o, const std::tuple<Ts...>& t) const
+	{
+		std::apply([&](const auto&... e) { (BinarySerializer<std::decay_t<decltype(e)>>{}(o, e), ...); }, t);
+	}
+};
+
+template <class... Ts>
+struct BinaryDeserializer<std::tuple<Ts...>>
+{
+	void operator()(std::istream& i, std::tuple<Ts...>& t) const
+	{
+		std::apply([&](auto&... e) { (BinaryDeserializer<std::decay_t<decltype(e)>>{}(i, e), ...); }, t);
 	}
 };
 
@@ -112,4 +405,170 @@ struct BinarySerializer<std::unordered_map<K, T>>
 			BinarySerializer<T>{}(o, it->second);
 		}
 	}
-};
\ No newline at end of file
+};
+
+template <class K, class T>
+struct BinaryDeserializer<std::unordered_map<K, T>>
+{
+	void operator()(std::istream& i, std::unordered_map<K, T>& m) const
+	{
+		typename std::unordered_map<K, T>::size_type size = 0;
+		BinaryDeserializer<decltype(size)>{}(i, size);
+		m.clear();
+		m.reserve(uze::getBoundedReserve<std::pair<K, T>>(size));
+		for (decltype(size) n = 0; n < size && i; ++n)
+		{
+			K key;
+			T value;
+			BinaryDeserializer<K>{}(i, key);
+			BinaryDeserializer<T>{}(i, value);
+			if (!i)
+				break;
+			m.emplace(std::move(key), std::move(value));
+		}
+	}
+};
+
+template <class K, class T>
+struct BinarySerializer<std::map<K, T>>
+{
+	void operator()(std::ostream& o, const std::map<K, T>& m) const
+	{
+		BinarySerializer<typename std::map<K, T>::size_type>{}(o, m.size());
+		for (auto it = m.begin(); it != m.end(); ++it)
+		{
+			BinarySerializer<K>{}(o, it->first);
+			BinarySerializer<T>{}(o, it->second);
+		}
+	}
+};
+
+template <class K, class T>
+struct BinaryDeserializer<std::map<K, T>>
+{
+	void operator()(std::istream& i, std::map<K, T>& m) const
+	{
+		typename std::map<K, T>::size_type size = 0;
+		BinaryDeserializer<decltype(size)>{}(i, size);
+		m.clear();
+		for (decltype(size) n = 0; n < size && i; ++n)
+		{
+			K key;
+			T value;
+			BinaryDeserializer<K>{}(i, key);
+			BinaryDeserializer<T>{}(i, value);
+			if (!i)
+				break;
+			// Keys were written in order, so every insertion is amortized O(1)
+			m.emplace_hint(m.end(), std::move(key), std::move(value));
+		}
+	}
+};
+
+template <class T>
+struct BinarySerializer<std::unordered_set<T>>
+{
+	void operator()(std::ostream& o, const std::unordered_set<T>& s) const
+	{
+		BinarySerializer<typename std::unordered_set<T>::size_type>{}(o, s.size());
+		for (const auto& e : s)
+		{
+			BinarySerializer<T>{}(o, e);
+		}
+	}
+};
+
+template <class T>
+struct BinaryDeserializer<std::unordered_set<T>>
+{
+	void operator()(std::istream& i, std::unordered_set<T>& s) const
+	{
+		typename std::unordered_set<T>::size_type size = 0;
+		BinaryDeserializer<decltype(size)>{}(i, size);
+		s.clear();
+		s.reserve(uze::getBoundedReserve<T>(size));
+		for (decltype(size) n = 0; n < size && i; ++n)
+		{
+			T value;
+			BinaryDeserializer<T>{}(i, value);
+			if (!i)
+				break;
+			s.insert(std::move(value));
+		}
+	}
+};
+
+template <class T>
+struct BinarySerializer<std::set<T>>
+{
+	void operator()(std::ostream& o, const std::set<T>& s) const
+	{
+		BinarySerializer<typename std::set<T>::size_type>{}(o, s.size());
+		for (const auto& e : s)
+		{
+			BinarySerializer<T>{}(o, e);
+		}
+	}
+};
+
+template <class T>
+struct BinaryDeserializer<std::set<T>>
+{
+	void operator()(std::istream& i, std::set<T>& s) const
+	{
+		typename std::set<T>::size_type size = 0;
+		BinaryDeserializer<decltype(size)>{}(i, size);
+		s.clear();
+		for (decltype(size) n = 0; n < size && i; ++n)
+		{
+			T value;
+			BinaryDeserializer<T>{}(i, value);
+			if (!i)
+				break;
+			s.emplace_hint(s.end(), std::move(value));
+		}
+	}
+};
+
+namespace uze
+{
+
+	// Seekable input stream over memory which isn't owned by the stream
+	class MemoryInputStream final : public std::istream
+	{
+	public:
+
+		MemoryInputStream(const void* data, u64 size)
+			: std::istream(&m_buffer), m_buffer(static_cast<const char*>(data), size) {}
+
+	private:
+
+		struct StreamBuffer final : std::streambuf
+		{
+			StreamBuffer(const char* data, u64 size)
+			{
+				char* begin = const_cast<char*>(data);
+				setg(begin, begin, begin + size);
+			}
+
+			pos_type seekoff(off_type offset, std::ios::seekdir dir, std::ios::openmode) override
+			{
+				char* base = dir == std::ios::beg ? eback() : dir == std::ios::cur ? gptr() : egptr();
+				char* target = base + offset;
+				if (target < eback() || target > egptr())
+					return pos_type(off_type(-1));
+
+				setg(eback(), target, egptr());
+				return pos_type(target - eback());
+			}
+
+			pos_type seekpos(pos_type pos, std::ios::openmode mode) override
+			{
+				return seekoff(off_type(pos), std::ios::beg, mode);
+			}
+		};
+
+		StreamBuffer m_buffer;
+	};
+
+}
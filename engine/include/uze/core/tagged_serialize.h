@@ -0,0 +1,322 @@
+#pragma once
+
+#include "uze/core/serialize_deserialize.h"
+#include "uze/core/type_id.h"
+#include <array>
+#include <type_traits>
+
+// Tagged binary format for reflected types:
+//
+//   u64 type hash | u32 version | u32 number of fields
+//   per field: u32 field id | u32 payload length | payload (BinarySerializer of the field)
+//
+// Field ids are hashes of field names and of the serialized structure of their types, so fields
+// may be reordered, added or removed between builds. Unknown fields are skipped with a single seek,
+// missing fields keep the values the object had before deserialization. Renaming a field or changing
+// its type loses its data, fields of one type which hash to the same id fail to compile.
+// The output stream must be seekable, lengths are patched after a field is written.
+
+namespace uze
+{
+
+	struct UZE SerializeVersion : refl::attr::usage::type
+	{
+		u32 value;
+
+		constexpr SerializeVersion(u32 value_) : value(value_) {}
+	};
+
+	struct UZE TaggedHeader
+	{
+		u64 type_hash{ 0 };
+		u32 version{ 0 };
+		u32 num_fields{ 0 };
+	};
+
+	namespace tagged
+	{
+
+		template <class T>
+		constexpr u64 getTypeHash()
+		{
+			return type_id_v<T>;
+		}
+
+		template <class T>
+		constexpr u32 getVersion()
+		{
+			constexpr auto td = refl::reflect<T>();
+			if constexpr (refl::descriptor::has_attribute<SerializeVersion>(td))
+				return refl::descriptor::get_attribute<SerializeVersion>(td).value;
+			else
+				return 1;
+		}
+
+		template <class Member>
+		constexpr bool isField(Member member)
+		{
+			if constexpr (refl::descriptor::is_field(member))
+				return !member.is_static && refl::descriptor::is_writable(member);
+			else
+				return false;
+		}
+
+		constexpr u32 combineHash(u32 hash, u64 value)
+		{
+			for (u32 n = 0; n < 8; ++n)
+			{
+				hash ^= static_cast<u8>(value >> (n * 8));
+				hash *= 0x01000193u;
+			}
+			return hash;
+		}
+
+		// Hash of how a type is serialized, the same with every compiler. Types without
+		// a specialization below which aren't reflected are only told apart by their size
+		template <class T>
+		struct TypeCode
+		{
+			static constexpr u32 get()
+			{
+				if constexpr (std::is_same_v<T, bool>)
+					return fnv1a32("bool");
+				else if constexpr (std::is_enum_v<T>)
+					return TypeCode<std::underlying_type_t<T>>::get();
+				else if constexpr (std::is_integral_v<T>)
+					return combineHash(fnv1a32(std::is_signed_v<T> ? "int" : "uint"), sizeof(T));
+				else if constexpr (std::is_floating_point_v<T>)
+					return combineHash(fnv1a32("float"), sizeof(T));
+				else if constexpr (refl::trait::is_reflectable_v<T>)
+					return combineHash(fnv1a32("struct"), type_id_v<T>);
+				else
+					return combineHash(fnv1a32("opaque"), sizeof(T));
+			}
+		};
+
+		template <>
+		struct TypeCode<std::string>
+		{
+			static constexpr u32 get() { return fnv1a32("string"); }
+		};
+
+		template <class T>
+		struct TypeCode<std::vector<T>>
+		{
+			static constexpr u32 get() { return combineHash(fnv1a32("vector"), TypeCode<T>::get()); }
+		};
+
+		template <class T, std::size_t N>
+		struct TypeCode<std::array<T, N>>
+		{
+			static constexpr u32 get() { return combineHash(combineHash(fnv1a32("array"), N), TypeCode<T>::get()); }
+		};
+
+		template <class T>
+		struct TypeCode<std::optional<T>>
+		{
+			static constexpr u32 get() { return combineHash(fnv1a32("optional"), TypeCode<T>::get()); }
+		};
+
+		template <class A, class B>
+		struct TypeCode<std::pair<A, B>>
+		{
+			static constexpr u32 get()
+			{
+				return combineHash(combineHash(fnv1a32("pair"), TypeCode<A>::get()), TypeCode<B>::get());
+			}
+		};
+
+		template <class... Ts>
+		struct TypeCode<std::tuple<Ts...>>
+		{
+			static constexpr u32 get()
+			{
+				u32 hash = fnv1a32("tuple");
+				((hash = combineHash(hash, TypeCode<Ts>::get())), ...);
+				return hash;
+			}
+		};
+
+		// Ordered and unordered containers are serialized the same way, so they share codes
+		template <class K, class T>
+		struct TypeCode<std::map<K, T>>
+		{
+			static constexpr u32 get()
+			{
+				return combineHash(combineHash(fnv1a32("map"), TypeCode<K>::get()), TypeCode<T>::get());
+			}
+		};
+
+		template <class K, class T>
+		struct TypeCode<std::unordered_map<K, T>> : TypeCode<std::map<K, T>> {};
+
+		template <class T>
+		struct TypeCode<std::set<T>>
+		{
+			static constexpr u32 get() { return combineHash(fnv1a32("set"), TypeCode<T>::get()); }
+		};
+
+		template <class T>
+		struct TypeCode<std::unordered_set<T>> : TypeCode<std::set<T>> {};
+
+		template <glm::length_t L, class T, glm::qualifier Q>
+		struct TypeCode<glm::vec<L, T, Q>>
+		{
+			static constexpr u32 get() { return combineHash(combineHash(fnv1a32("vec"), L), TypeCode<T>::get()); }
+		};
+
+		template <glm::length_t C, glm::length_t R, class T, glm::qualifier Q>
+		struct TypeCode<glm::mat<C, R, T, Q>>
+		{
+			static constexpr u32 get()
+			{
+				return combineHash(combineHash(combineHash(fnv1a32("mat"), C), R), TypeCode<T>::get());
+			}
+		};
+
+		template <class T, glm::qualifier Q>
+		struct TypeCode<glm::qua<T, Q>>
+		{
+			static constexpr u32 get() { return combineHash(fnv1a32("quat"), TypeCode<T>::get()); }
+		};
+
+		// A field whose type changed gets a new id, its old data is skipped like an unknown field
+		template <class Member>
+		constexpr u32 getFieldId(Member member)
+		{
+			using FieldT = std::remove_cv_t<typename Member::value_type>;
+			return combineHash(fnv1a32(member.name.c_str()), TypeCode<FieldT>::get());
+		}
+
+		template <class T>
+		constexpr u32 getNumFields()
+		{
+			u32 num_fields = 0;
+			for_each(refl::reflect<T>().members, [&](auto member)
+			{
+				if constexpr (isField(member))
+					++num_fields;
+			});
+			return num_fields;
+		}
+
+		template <class T>
+		constexpr auto getFieldIds()
+		{
+			std::array<u32, getNumFields<T>()> ids{};
+			u32 count = 0;
+			for_each(refl::reflect<T>().members, [&](auto member)
+			{
+				if constexpr (isField(member))
+					ids[count++] = getFieldId(member);
+			});
+			return ids;
+		}
+
+		// Fields are matched by id only, two colliding names would read each other's data
+		template <class T>
+		constexpr bool hasUniqueFieldIds()
+		{
+			constexpr auto ids = getFieldIds<T>();
+			for (u64 a = 0; a < ids.size(); ++a)
+			{
+				for (u64 b = a + 1; b < ids.size(); ++b)
+				{
+					if (ids[a] == ids[b])
+						return false;
+				}
+			}
+			return true;
+		}
+
+		template <class T, class = void>
+		struct HasUpgrade : std::false_type {};
+
+		template <class T>
+		struct HasUpgrade<T, std::void_t<decltype(std::declval<T&>().upgradeFrom(u32{}))>> : std::true_type {};
+
+	}
+
+}
+
+// Types which need to fix up data written by older versions may declare
+// `void upgradeFrom(uze::u32 version)`, it's called after all known fields were read.
+template <class T>
+struct TaggedBinarySerializer
+{
+	static_assert(uze::tagged::hasUniqueFieldIds<T>(), "fields of the type hash to the same field id, rename one of them");
+
+	void operator()(std::ostream& o, const T& obj) const
+	{
+		BinarySerializer<uze::u64>{}(o, uze::tagged::getTypeHash<T>());
+		BinarySerializer<uze::u32>{}(o, uze::tagged::getVersion<T>());
+		BinarySerializer<uze::u32>{}(o, uze::tagged::getNumFields<T>());
+
+		for_each(refl::reflect<T>().members, [&](auto member)
+		{
+			if constexpr (uze::tagged::isField(member))
+			{
+				using FieldT = typename decltype(member)::value_type;
+
+				BinarySerializer<uze::u32>{}(o, uze::tagged::getFieldId(member));
+				const auto length_pos = o.tellp();
+				BinarySerializer<uze::u32>{}(o, 0);
+				BinarySerializer<FieldT>{}(o, member(obj));
+
+				const auto end_pos = o.tellp();
+				o.seekp(length_pos);
+				BinarySerializer<uze::u32>{}(o, static_cast<uze::u32>(end_pos - length_pos) - sizeof(uze::u32));
+				o.seekp(end_pos);
+			}
+		});
+	}
+};
+
+template <class T>
+struct TaggedBinaryDeserializer
+{
+	static_assert(uze::tagged::hasUniqueFieldIds<T>(), "fields of the type hash to the same field id, rename one of them");
+
+	void operator()(std::istream& i, T& obj) const
+	{
+		uze::TaggedHeader header;
+		BinaryDeserializer<uze::u64>{}(i, header.type_hash);
+		BinaryDeserializer<uze::u32>{}(i, header.version);
+		BinaryDeserializer<uze::u32>{}(i, header.num_fields);
+
+		if (!i || header.type_hash != uze::tagged::getTypeHash<T>())
+		{
+			i.setstate(std::ios::failbit);
+			return;
+		}
+
+		for (uze::u32 n = 0; n < header.num_fields && i; ++n)
+		{
+			uze::u32 id;
+			uze::u32 length;
+			BinaryDeserializer<uze::u32>{}(i, id);
+			BinaryDeserializer<uze::u32>{}(i, length);
+			const auto field_end = i.tellg() + static_cast<std::streamoff>(length);
+
+			for_each(refl::reflect<T>().members, [&](auto member)
+			{
+				if constexpr (uze::tagged::isField(member))
+				{
+					using FieldT = typename decltype(member)::value_type;
+
+					if (uze::tagged::getFieldId(member) == id)
+						BinaryDeserializer<FieldT>{}(i, member(obj));
+				}
+			});
+
+			// Known or not, continue from the end of the field
+			i.seekg(field_end);
+		}
+
+		if constexpr (uze::tagged::HasUpgrade<T>::value)
+		{
+			if (i && header.version < uze::tagged::getVersion<T>())
+				obj.upgradeFrom(header.version);
+		}
+	}
+};
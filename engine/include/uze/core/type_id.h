@@ -0,0 +1,28 @@
+#pragma once
+
+#include "uze/core/hash.h"
+#include <refl.hpp>
+
+namespace uze
+{
+
+	using TypeId = u64;
+
+	// Stable across builds and platforms, derived from the reflected type name
+	template <class T>
+	constexpr TypeId getTypeId()
+	{
+		return fnv1a64(refl::reflect<T>().name.c_str());
+	}
+
+	// Always a compile-time constant. getTypeId<T>() called outside of a constant expression
+	// may hash the name on every call in unoptimized builds
+	template <class T>
+	inline constexpr TypeId type_id_v = getTypeId<T>();
+
+	inline TypeId getTypeId(std::string_view name)
+	{
+		return fnv1a64(name);
+	}
+
+}
@@ -1,8 +1,14 @@
 #pragma once
 
 #include "uze/core/serialize_deserialize.h"
+#include "uze/core/tagged_serialize.h"
+#include "uze/core/type_id.h"
 #include <refl.hpp>
-#include <functional>
+#include <algorithm>
+#include <array>
+#include <string>
+#include <string_view>
+#include <type_traits>
 
 #if defined(UZE_REFLECTION_GENERATOR) && UZE_REFLECTION_GENERATOR == 1
 #define uzclass class [[clang::annotate("uze_reflect")]]
@@ -18,26 +24,93 @@ namespace uze
 
 	enum class UZE TypeMemberType
 	{
-		Unknown, Int, Float, Double, String, ObjectRef
+		Unknown, Bool, Int8, Int16, Int32, Int64, UInt8, UInt16, UInt32, UInt64,
+		Float, Double, String, Enum, Struct, ObjectRef
 	};
 
+	// Non-static field of a reflected type. Offset is relative to a pointer to the type itself,
+	// not to one of its bases, so `object` passed to accessors must point to the registered type
 	struct UZE TypeMember
 	{
-		std::string name;
-		TypeMemberType type;
+		std::string_view name;
+		TypeMemberType type{ TypeMemberType::Unknown };
+		// Id of the field type for reflected structs and of the pointee for ObjectRef, 0 otherwise
+		TypeId type_id{ 0 };
+		u32 offset{ 0 };
+		u32 size{ 0 };
+		u32 alignment{ 0 };
+		// Field may be copied with memcpy of `size` bytes at `offset`
+		bool trivially_copyable{ false };
+
+		// Copy the field out of/into an object with copy assignment, `value` points to an instance
+		// of the field type. Null if the field isn't copy assignable, setter is also null for const fields
+		void (*getter)(const void* object, void* value) { nullptr };
+		void (*setter)(void* object, const void* value) { nullptr };
+
+		void* getAddress(void* object) const { return static_cast<u8*>(object) + offset; }
+		const void* getAddress(const void* object) const { return static_cast<const u8*>(object) + offset; }
 	};
 
+	template <class T>
+	struct ArrayView
+	{
+		const T* first{ nullptr };
+		u32 count{ 0 };
+
+		const T* begin() const { return first; }
+		const T* end() const { return first + count; }
+		const T& operator[](u32 index) const { return first[index]; }
+		u32 size() const { return count; }
+		bool empty() const { return count == 0; }
+	};
+
+	// Immutable once registered. Types, members, parent lists and names of all types registered
+	// by the same Registry::init() are stored in a few flat arrays, see Registry::freeze
 	struct UZE TypeInfo
 	{
-		std::string name;
-		std::vector<TypeInfo*> parents;
-		std::vector<TypeMember> members;
+		std::string_view name;
+		TypeId id{ 0 };
+		u32 index{ 0 };
+		u32 size{ 0 };
+		u32 alignment{ 0 };
+		bool trivially_copyable{ false };
+		ArrayView<const TypeInfo*> parents;
+		ArrayView<TypeMember> members;
+
+		// Number of types on the first-parent chain above this type
+		u32 depth{ 0 };
+		// Indices of the types on the first-parent chain, by depth, ending with the type itself
+		ArrayView<u32> primary_ancestors;
+		// Sorted indices of the remaining ancestors, empty without multiple inheritance
+		ArrayView<u32> secondary_ancestors;
+
+		// Constant time for single inheritance, binary search through
+		// secondary ancestors otherwise
+		bool isA(const TypeInfo& other) const
+		{
+			if (other.depth <= depth && primary_ancestors[other.depth] == other.index)
+				return true;
+
+			return !secondary_ancestors.empty()
+				&& std::binary_search(secondary_ancestors.begin(), secondary_ancestors.end(), other.index);
+		}
+
+		const TypeMember* findMember(std::string_view member_name) const
+		{
+			for (const auto& member : members)
+			{
+				if (member.name == member_name)
+					return &member;
+			}
+			return nullptr;
+		}
 	};
 
 	class UZE Object
 	{
 	public:
 
+		static const TypeInfo& getStaticTypeInfo();
 		virtual const TypeInfo& getTypeInfo() const;
 
 		virtual ~Object() = default;
@@ -48,18 +121,233 @@ namespace uze
 
 REFL_AUTO(type(uze::Object));
 
+namespace uze
+{
+
+	template <class T>
+	constexpr TypeMemberType getMemberType()
+	{
+		if constexpr (std::is_same_v<T, bool>)
+			return TypeMemberType::Bool;
+		else if constexpr (std::is_enum_v<T>)
+			return TypeMemberType::Enum;
+		else if constexpr (std::is_integral_v<T>)
+		{
+			constexpr TypeMemberType signed_types[] = { TypeMemberType::Int8, TypeMemberType::Int16,
+				TypeMemberType::Unknown, TypeMemberType::Int32, TypeMemberType::Unknown,
+				TypeMemberType::Unknown, TypeMemberType::Unknown, TypeMemberType::Int64 };
+			constexpr TypeMemberType unsigned_types[] = { TypeMemberType::UInt8, TypeMemberType::UInt16,
+				TypeMemberType::Unknown, TypeMemberType::UInt32, TypeMemberType::Unknown,
+				TypeMemberType::Unknown, TypeMemberType::Unknown, TypeMemberType::UInt64 };
+			return std::is_signed_v<T> ? signed_types[sizeof(T) - 1] : unsigned_types[sizeof(T) - 1];
+		}
+		else if constexpr (std::is_same_v<T, float>)
+			return TypeMemberType::Float;
+		else if constexpr (std::is_same_v<T, double>)
+			return TypeMemberType::Double;
+		else if constexpr (std::is_same_v<T, std::string>)
+			return TypeMemberType::String;
+		else if constexpr (std::is_pointer_v<T> && std::is_base_of_v<Object, std::remove_cv_t<std::remove_pointer_t<T>>>)
+			return TypeMemberType::ObjectRef;
+		else if constexpr (refl::trait::is_reflectable_v<T>)
+			return TypeMemberType::Struct;
+		else
+			return TypeMemberType::Unknown;
+	}
+
+	// refl-cpp only provides member pointers, which can't be used with offsetof,
+	// so the offset is measured on a real object. Fields of virtual bases aren't supported
+	template <class T, class Pointer>
+	u32 getMemberOffset(const T& object, Pointer pointer)
+	{
+		return static_cast<u32>(reinterpret_cast<const u8*>(&(object.*pointer)) - reinterpret_cast<const u8*>(&object));
+	}
+
+	template <class Member>
+	constexpr bool isInstanceField(Member member)
+	{
+		if constexpr (refl::descriptor::is_field(member))
+			return !member.is_static;
+		else
+			return false;
+	}
+
+	// Static description of a registered type. It's constant-initialized, so registrars only link it
+	// into a list without allocating, and may run before the registry itself is initialized
+	struct UZE TypeRegistration
+	{
+		struct Parent
+		{
+			TypeId id{ 0 };
+			std::string_view name;
+		};
+
+		std::string_view name;
+		TypeId id{ 0 };
+		u32 size{ 0 };
+		u32 alignment{ 0 };
+		bool trivially_copyable{ false };
+		const Parent* parents{ nullptr };
+		u32 num_parents{ 0 };
+		u32 num_members{ 0 };
+		// Fills num_members members, names point to static strings of refl-cpp
+		void (*write_members)(TypeMember* members) { nullptr };
+
+		TypeRegistration* next{ nullptr };
+		bool linked{ false };
+		bool visited{ false };
+	};
+
+	namespace registration
+	{
+
+		template <class T>
+		constexpr u32 getNumMembers()
+		{
+			u32 count = 0;
+			for_each(refl::reflect<T>().members, [&](auto member)
+			{
+				if constexpr (isInstanceField(member))
+					++count;
+			});
+			return count;
+		}
+
+		template <class T>
+		constexpr auto getParents()
+		{
+			constexpr auto td = refl::reflect<T>();
+			std::array<TypeRegistration::Parent, td.declared_bases.size> parents{};
+			u32 count = 0;
+			for_each(reflect_types(td.declared_bases), [&](auto t)
+			{
+				parents[count++] = { getTypeId<typename decltype(t)::type>(), t.name.c_str() };
+			});
+			return parents;
+		}
+
+		template <class T>
+		inline constexpr auto type_parents = getParents<T>();
+
+		template <class T, class Member>
+		TypeMember makeMember(const T& object, Member member)
+		{
+			using M = std::remove_cv_t<typename Member::value_type>;
+
+			TypeMember m;
+			m.name = get_display_name(member);
+			m.type = getMemberType<M>();
+			m.offset = getMemberOffset(object, member.pointer);
+			m.size = sizeof(M);
+			m.alignment = alignof(M);
+			m.trivially_copyable = std::is_trivially_copyable_v<M>;
+
+			if constexpr (refl::trait::is_reflectable_v<M>)
+				m.type_id = type_id_v<M>;
+			else if constexpr (std::is_pointer_v<M> && refl::trait::is_reflectable_v<std::remove_cv_t<std::remove_pointer_t<M>>>)
+				m.type_id = type_id_v<std::remove_cv_t<std::remove_pointer_t<M>>>;
+
+			if constexpr (std::is_copy_assignable_v<M>)
+			{
+				m.getter = [](const void* object, void* value)
+				{
+					*static_cast<M*>(value) = Member{}(*static_cast<const T*>(object));
+				};
+
+				if constexpr (is_writable(member))
+				{
+					m.setter = [](void* object, const void* value)
+					{
+						Member{}(*static_cast<T*>(object)) = *static_cast<const M*>(value);
+					};
+				}
+			}
+
+			return m;
+		}
+
+		template <class T>
+		void writeMembers(TypeMember* members)
+		{
+			if constexpr (getNumMembers<T>() > 0)
+			{
+				static_assert(std::is_default_constructible_v<T>,
+					"types with reflected fields have to be default constructible, offsets are measured on an instance");
+
+				const T object{};
+				for_each(refl::reflect<T>().members, [&](auto member)
+				{
+					if constexpr (isInstanceField(member))
+						*members++ = makeMember(object, member);
+				});
+			}
+		}
+
+		template <class T>
+		constexpr TypeRegistration makeRegistration()
+		{
+			TypeRegistration r{};
+			r.name = refl::reflect<T>().name.c_str();
+			r.id = getTypeId<T>();
+			r.size = sizeof(T);
+			r.alignment = alignof(T);
+			r.trivially_copyable = std::is_trivially_copyable_v<T>;
+			r.parents = type_parents<T>.data();
+			r.num_parents = static_cast<u32>(type_parents<T>.size());
+			r.num_members = getNumMembers<T>();
+			r.write_members = &writeMembers<T>;
+			return r;
+		}
+
+		// Has to be a constant, a registration built by a dynamic initializer could be linked
+		// into the list after registrars of other translation units already ran
+		template <class T>
+		inline constexpr TypeRegistration constant_registration = makeRegistration<T>();
+
+		// Copy of a constant, so it's constant-initialized as well
+		template <class T>
+		inline TypeRegistration type_registration = constant_registration<T>;
+
+	}
+
+	// T has to be declared with UZE_OBJECT and registered. Cheaper than dynamic_cast,
+	// doesn't look through virtual inheritance
+	template <class T>
+	bool isA(const Object* object)
+	{
+		return object && object->getTypeInfo().isA(T::getStaticTypeInfo());
+	}
+
+	template <class T>
+	T* cast(Object* object)
+	{
+		return isA<T>(object) ? static_cast<T*>(object) : nullptr;
+	}
+
+	template <class T>
+	const T* cast(const Object* object)
+	{
+		return isA<T>(object) ? static_cast<const T*>(object) : nullptr;
+	}
+
+}
+
 #define UZE_OBJECT(T) \
 	public: using ThisT = T; \
-	virtual const TypeInfo& getTypeInfo() const override;
+	static const ::uze::TypeInfo& getStaticTypeInfo(); \
+	virtual const ::uze::TypeInfo& getTypeInfo() const override;
 
 #define UZE_REFLECT(T, ...) \
 	UZE_EXPAND(REFL_AUTO(__VA_ARGS__)) \
-	const ::uze::TypeInfo& ::T::getTypeInfo() const \
+	const ::uze::TypeInfo& ::T::getStaticTypeInfo() \
 	{ \
-		static TypeInfo* ti = Registry::getTypeInfo( \
-			::refl::reflect<T>().name.c_str()); \
+		static const ::uze::TypeInfo* ti = ::uze::Registry::getTypeInfo<T>(); \
 		return *ti; \
 	} \
+	const ::uze::TypeInfo& ::T::getTypeInfo() const \
+	{ \
+		return getStaticTypeInfo(); \
+	} \
 	namespace UZE_CONCAT(Z_, UZE_CONCAT(__COUNTER__, _UZE_REFLECTION))\
 	{ \
 		struct Z_register \
@@ -85,6 +373,15 @@ public:
 
 };
 
+REFL_AUTO(
+	type(EntityTest, uze::SerializeVersion(1)),
+	field(name),
+	field(health),
+	field(x),
+	field(y),
+	field(indices)
+)
+
 /*...*/
 
 template<>
@@ -122,58 +419,57 @@ namespace uze
 	{
 	public:
 
+		// Builds TypeInfo of all types registered so far and logs how long it took
 		static void init();
 
+		// Called by static registrars of UZE_REFLECT, types registered after init() are added immediately
 		template <class T>
-		constexpr static void registerType()
+		static void registerType()
 		{
-			get().registerImpl([]()
-			{
-				refl::type_descriptor<T> td = refl::reflect<T>();
-
-				auto ti = new TypeInfo();
-				ti->name = td.name.c_str();
-
-				if constexpr (td.declared_bases.size)
-				{
-					for_each(reflect_types(td.declared_bases), [&](auto t)
-					{
-						auto pti = getTypeInfo(t.name.c_str());
-						if (!pti)
-						{
-							logWarn(fmt::format("Type `{}` inherits from `{}`, but it's isn't registered",
-								ti->name, t.name.c_str()));
-							return;
-						}
-
-						ti->parents.push_back(pti);
-					});
-				}
-
-				for_each(td.members, [&](auto member)
-				{
-					if constexpr (is_readable(member))
-					{
-						ti->members.push_back({ get_display_name(member), TypeMemberType::Unknown });
-					}
-				});
-
-				get().addType(ti);
-			});
+			registerImpl(registration::type_registration<T>);
 		}
 
-		static TypeInfo* getTypeInfo(std::string_view name);
-
-	private:
+		template <class T>
+		static const TypeInfo* getTypeInfo() { return getTypeInfo(type_id_v<T>); }
 
-		std::unordered_map<std::string, std::shared_ptr<TypeInfo>> m_types;
+		static const TypeInfo* getTypeInfo(TypeId id);
+		static const TypeInfo* getTypeInfo(std::string_view name) { return getTypeInfo(getTypeId(name)); }
+		static const TypeInfo* getTypeInfoByIndex(u32 index);
+		static u32 getNumTypes();
 
-		void addType(TypeInfo* ti);
-		void registerImpl(const std::function<void()>& func);
+	private:
 
+		// Storage of the types frozen together, never resized after it's filled
+		struct Arena
+		{
+			std::vector<TypeInfo> types;
+			std::vector<TypeMember> members;
+			std::vector<const TypeInfo*> parents;
+			std::vector<u32> ancestors;
+			std::string names;
+		};
+
+		struct TypeIndexSlot
+		{
+			TypeId id{ 0 };
+			u32 index{ 0 };
+		};
+
+		std::vector<std::unique_ptr<Arena>> m_arenas;
+		// Indexed by TypeInfo::index
+		std::vector<const TypeInfo*> m_types;
+		// Open addressing by id with linear probing, ids are hashes already.
+		// Capacity is a power of two and at least twice the number of types
+		std::vector<TypeIndexSlot> m_type_indices;
+
+		// Moves pending types into a new arena. Called by init(),
+		// types registered after it are frozen one by one
+		void freeze();
+		const TypeIndexSlot* findTypeIndex(TypeId id) const;
+		void insertTypeIndex(TypeId id, u32 index);
+
+		static void registerImpl(TypeRegistration& registration);
 		static Registry& get();
-		static std::vector<std::function<void()>>& getRegisterQueue();
-		static void logWarn(std::string_view str);
 
 	};
 
@@ -1,8 +1,15 @@
 #pragma once
 
 #include <ios>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <atomic>
 #include <fmt/format.h>
 #include "uze/platform.h"
+#include "uze/types.h"
+#include "uze/core/hash.h"
 
 #if UZE_PLATFORM == UZE_PLATFORM_WINDOWS && defined(UZE_EXPORT_DLL)
 #	if defined(UZE_EXPORT)
@@ -18,68 +25,309 @@
 namespace uze
 {
 
-	using i8 = std::int8_t;
-	using i16 = std::int16_t;
-	using i32 = std::int32_t;
-	using i64 = std::int64_t;
-	using u8 = std::uint8_t;
-	using u16 = std::uint16_t;
-	using u32 = std::uint32_t;
-	using u64 = std::uint64_t;
-
 	UZE std::ostream& getOutputStream();
 	UZE void initLogging(std::ostream& out);
+	// Writes text to the output stream as is, never in the middle of a log message. Not passed to sinks,
+	// meant for console status lines. With async logging it's queued and the logging thread writes
+	// only the latest text of each batch, otherwise it's written and flushed under the logger's lock
+	UZE void writeLogOutput(std::string_view text);
+
+	enum class UZE LogOverflowPolicy
+	{
+		// Messages which don't fit into the thread's buffer are counted and dropped
+		Drop,
+		// Producer waits until the logging thread frees enough space
+		Block
+	};
+
+	// Moves writing to a background thread. Every thread logs into its own lock-free ring buffer
+	// of buffer_size bytes, the logging thread formats and writes them in batches.
+	// Does nothing on web, logging stays synchronous there
+	UZE void startAsyncLogging(LogOverflowPolicy policy = LogOverflowPolicy::Drop, u64 buffer_size = 64 * 1024);
+	// Writes everything logged so far and joins the logging thread.
+	// Messages logged by other threads while it stops may be lost
+	UZE void stopAsyncLogging();
+	// Blocks until everything logged by now is written to the output stream
+	UZE void flushLog();
+	UZE u64 getNumDroppedLogs();
+
+	enum class UZE LogFormat
+	{
+		// `[LEVEL] Category: message key=value`
+		Text,
+		// One object per line with time in nanoseconds since the Unix epoch, thread index, level,
+		// category, file, line, message and fields
+		Json
+	};
+
+	// Format of the lines written to the output stream and sinks, Text by default
+	UZE void setLogFormat(LogFormat format);
+
+	// While set, every message is written to out as a compact binary record instead of text,
+	// uzLogBinary messages aren't formatted at all. Pass nullptr to go back to text. Read with decodeBinaryLog
+	UZE void initBinaryLogging(std::ostream* out);
+	// Formats a log written by initBinaryLogging the same way text logging would have,
+	// returns false if the input isn't a binary log or ends in the middle of a record
+	UZE bool decodeBinaryLog(std::istream& in, std::ostream& out, LogFormat format = LogFormat::Text);
 
 	enum UZE LogLevel
 	{
 		LL_Debug, LL_Info, LL_Warn, LL_Error
 	};
 
+	// Categories are looked up at runtime by the hash of their name. Categories whose hashes
+	// collide share their runtime level
+	constexpr u32 log_level_slots = 1024;
+
 	struct UZE LogCategory
 	{
 		const char* name;
+		// Messages below it are compiled out
 		LogLevel min_level;
+		u32 level_slot;
 
 		constexpr LogCategory(const char* name_, LogLevel min_level_ = LL_Debug)
-			: name(name_), min_level(min_level_) {}
+			: name(name_), min_level(min_level_), level_slot(fnv1a32(name_) & (log_level_slots - 1)) {}
 	};
 
-#define LOG_FN_ARGS std::string_view, std::string_view, u64
-	using LogFunction = void(*)(LOG_FN_ARGS);
+	// Runtime level of every category slot, see setLogLevel
+	UZE extern std::atomic<u8> uzLog_levels[log_level_slots];
+
+	inline bool uzLog_isEnabled(const LogCategory& category, LogLevel level)
+	{
+		return level >= uzLog_levels[category.level_slot].load(std::memory_order_relaxed);
+	}
+
+	// Sets the runtime level of every category which doesn't have its own, LL_Debug by default
+	UZE void setLogLevel(LogLevel level);
+	// Messages of the category below the level are skipped before they're formatted.
+	// Can't enable messages compiled out by LogCategory::min_level
+	UZE void setLogLevel(std::string_view category, LogLevel level);
+	// Category goes back to the level set by setLogLevel(LogLevel)
+	UZE void resetLogLevel(std::string_view category);
+	UZE LogLevel getLogLevel(std::string_view category);
 
-	UZE void uzLog_ImplDebug(LOG_FN_ARGS);
-	UZE void uzLog_ImplInfo(LOG_FN_ARGS);
-	UZE void uzLog_ImplWarn(LOG_FN_ARGS);
-	UZE void uzLog_ImplError(LOG_FN_ARGS);
-	UZE void uzLog_ImplUnknown(LOG_FN_ARGS);
+	// Pushes the message into the thread's ring buffer if async logging is running,
+	// otherwise formats and writes it right away
+	UZE void uzLog_Impl(const LogCategory& category, LogLevel level, std::string_view log,
+		std::string_view file, u64 line);
 
-	constexpr auto UZE uzLog_getFunction(LogLevel level) -> LogFunction
+#define UZ_EXPAND(x) x
+
+#define uzLog(category, level, ...) \
+	if constexpr (category.min_level <= LL_##level) \
+		if (::uze::uzLog_isEnabled(category, LL_##level)) \
+			uzLog_Impl(category, LL_##level, UZ_EXPAND(::fmt::format(__VA_ARGS__)), __FILE__, __LINE__)
+
+	// Static description of a uzLogBinary or uzLogFields call, only its address is recorded with each message
+	struct UZE LogSite
 	{
-		switch (level)
+		const char* category;
+		LogLevel level;
+		// Message itself for uzLogFields
+		std::string_view format;
+		std::string_view file;
+		u32 line;
+		// Arguments are key-value pairs of uzLogFields
+		bool structured{ false };
+	};
+
+	enum class UZE LogArgType : u8
+	{
+		Bool, Char, Int, UInt, Double, Pointer, String
+	};
+
+	// Arguments are stored as a type tag followed by raw bytes. Types without an encoding
+	// of their own are formatted into strings at the call site
+	namespace log_args
+	{
+
+		// Number of automatically indexed replacement fields
+		constexpr u64 countFields(std::string_view format)
+		{
+			u64 count = 0;
+			for (u64 n = 0; n < format.size(); ++n)
+			{
+				if (format[n] != '{')
+					continue;
+
+				if (n + 1 < format.size() && format[n + 1] == '{')
+					++n;
+				else
+					++count;
+			}
+			return count;
+		}
+
+		template <class... Args>
+		std::integral_constant<u64, sizeof...(Args)> count(const Args&...);
+
+		template <class T>
+		decltype(auto) toEncodable(const T& arg)
 		{
-		case LL_Debug:
-			return uzLog_ImplDebug;
-		case LL_Info:
-			return uzLog_ImplInfo;
-		case LL_Warn:
-			return uzLog_ImplWarn;
-		case LL_Error:
-			return uzLog_ImplError;
-		default:
-			return uzLog_ImplUnknown;
+			if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>
+				|| std::is_convertible_v<const T&, std::string_view>)
+				return (arg);
+			else
+				return ::fmt::format("{}", arg);
 		}
+
+		template <class T>
+		u64 getSize(const T& arg)
+		{
+			if constexpr (std::is_same_v<T, bool> || std::is_same_v<T, char>)
+				return 2;
+			else if constexpr (std::is_enum_v<T>)
+				return getSize(static_cast<std::underlying_type_t<T>>(arg));
+			else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+				return 1 + sizeof(u32) + std::string_view(arg).size();
+			else
+				return 1 + sizeof(u64);
+		}
+
+		inline u8* writeRaw(u8* out, LogArgType type, const void* data, u64 size)
+		{
+			*out = static_cast<u8>(type);
+			std::memcpy(out + 1, data, size);
+			return out + 1 + size;
+		}
+
+		template <class T>
+		u8* write(u8* out, const T& arg)
+		{
+			if constexpr (std::is_same_v<T, bool>)
+				return writeRaw(out, LogArgType::Bool, &arg, 1);
+			else if constexpr (std::is_same_v<T, char>)
+				return writeRaw(out, LogArgType::Char, &arg, 1);
+			else if constexpr (std::is_enum_v<T>)
+				return write(out, static_cast<std::underlying_type_t<T>>(arg));
+			else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+			{
+				const i64 value = arg;
+				return writeRaw(out, LogArgType::Int, &value, sizeof(value));
+			}
+			else if constexpr (std::is_integral_v<T>)
+			{
+				const u64 value = arg;
+				return writeRaw(out, LogArgType::UInt, &value, sizeof(value));
+			}
+			else if constexpr (std::is_floating_point_v<T>)
+			{
+				const double value = arg;
+				return writeRaw(out, LogArgType::Double, &value, sizeof(value));
+			}
+			else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+			{
+				const std::string_view str(arg);
+				const u32 size = static_cast<u32>(str.size());
+				out = writeRaw(out, LogArgType::String, &size, sizeof(size));
+				std::memcpy(out, str.data(), size);
+				return out + size;
+			}
+			else
+			{
+				const u64 value = reinterpret_cast<std::uintptr_t>(arg);
+				return writeRaw(out, LogArgType::Pointer, &value, sizeof(value));
+			}
+		}
+
 	}
 
-	constexpr void UZE uzLog_Impl(const LogCategory& category, LogLevel level, std::string_view log,
-		std::string_view file, u64 line)
+	// Returns storage for `size` bytes of encoded arguments or null if the message is dropped,
+	// uzLog_EndBinary has to be called after the storage is filled
+	UZE u8* uzLog_BeginBinary(const LogSite& site, u64 size);
+	UZE void uzLog_EndBinary(const LogSite& site);
+
+	template <class... Args>
+	void uzLog_EncodeBinary(const LogSite& site, const Args&... args)
 	{
-		uzLog_getFunction(level)(::fmt::format("{}: {}", category.name, log), file, line);
+		if (u8* out = uzLog_BeginBinary(site, (u64(0) + ... + log_args::getSize(args))))
+		{
+			((out = log_args::write(out, args)), ...);
+			uzLog_EndBinary(site);
+		}
 	}
 
-#define UZ_EXPAND(x) x
+	template <class... Args>
+	void uzLog_Binary(const LogSite& site, const Args&... args)
+	{
+		uzLog_EncodeBinary(site, log_args::toEncodable(args)...);
+	}
 
-#define uzLog(category, level, ...) \
+	template <class T>
+	struct LogField
+	{
+		std::string_view key;
+		const T& value;
+	};
+
+	// Typed value attached to a uzLogFields message, the key should be a string literal
+	template <class T>
+	LogField<T> logField(std::string_view key, const T& value)
+	{
+		return { key, value };
+	}
+
+	template <class... T>
+	void uzLog_EncodeFields(const LogSite& site, const LogField<T>&... fields)
+	{
+		const u64 size = (u64(0) + ... + (log_args::getSize(fields.key) + log_args::getSize(fields.value)));
+		if (u8* out = uzLog_BeginBinary(site, size))
+		{
+			((out = log_args::write(log_args::write(out, fields.key), fields.value)), ...);
+			uzLog_EndBinary(site);
+		}
+	}
+
+	template <class... T>
+	void uzLog_Fields(const LogSite& site, const LogField<T>&... fields)
+	{
+		uzLog_EncodeFields(site, LogField<std::decay_t<decltype(log_args::toEncodable(fields.value))>>{
+			fields.key, log_args::toEncodable(fields.value) }...);
+	}
+
+	// Per call site state of uzLogLimited
+	struct UZE LogRateLimit
+	{
+		std::atomic<u64> window_start{ 0 };
+		std::atomic<u32> count{ 0 };
+		std::atomic<u32> suppressed{ 0 };
+
+		// At most max_per_second messages are allowed in every second. The first message of a second
+		// gets the number of messages suppressed since the previous one
+		bool allow(u32 max_per_second, u32& suppressed_before);
+	};
+
+// Same as uzLog, but messages over max_per_second are dropped before they're formatted.
+// The next message tells how many were dropped
+#define uzLogLimited(category, level, max_per_second, ...) \
+	if constexpr (category.min_level <= LL_##level) \
+		if (static ::uze::LogRateLimit uz_log_limit; ::uze::uzLog_isEnabled(category, LL_##level)) \
+			if (::uze::u32 uz_log_suppressed; uz_log_limit.allow(max_per_second, uz_log_suppressed)) \
+				uzLog_Impl(category, LL_##level, uz_log_suppressed \
+					? ::fmt::format("{} ({} similar messages suppressed)", UZ_EXPAND(::fmt::format(__VA_ARGS__)), uz_log_suppressed) \
+					: UZ_EXPAND(::fmt::format(__VA_ARGS__)), __FILE__, __LINE__)
+
+// Same as uzLog, but the format has to be a string literal and formatting is deferred
+// to the logging thread or to decodeBinaryLog, the call site only copies the arguments
+#define uzLogBinary(category, level, format, ...) \
 	if constexpr (category.min_level <= LL_##level) \
-		uzLog_Impl(category, LL_##level, UZ_EXPAND(::fmt::format(__VA_ARGS__)), __FILE__, __LINE__)
+	{ \
+		static_assert(::uze::log_args::countFields(format) \
+			== decltype(::uze::log_args::count(__VA_ARGS__))::value, "Wrong number of log arguments"); \
+		static constexpr ::uze::LogSite uz_log_site { category.name, LL_##level, format, __FILE__, __LINE__ }; \
+		if (::uze::uzLog_isEnabled(category, LL_##level)) \
+			::uze::uzLog_Binary(uz_log_site, ##__VA_ARGS__); \
+	}
+
+// Structured message with a constant text and typed fields made by logField,
+// e.g. uzLogFields(log_renderer, Error, "OpenGL error", logField("code", err))
+#define uzLogFields(category, level, message, ...) \
+	if constexpr (category.min_level <= LL_##level) \
+	{ \
+		static constexpr ::uze::LogSite uz_log_site { category.name, LL_##level, message, __FILE__, __LINE__, true }; \
+		if (::uze::uzLog_isEnabled(category, LL_##level)) \
+			::uze::uzLog_Fields(uz_log_site, ##__VA_ARGS__); \
+	}
 
-}
\ No newline at end of file
+}
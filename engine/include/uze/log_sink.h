@@ -0,0 +1,89 @@
+#pragma once
+
+#include "uze/common.h"
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+namespace uze
+{
+
+	// Receives formatted text, usually a batch of whole lines. Sinks are called by one thread
+	// at a time, the stream set by initLogging is always written before them
+	class UZE LogSink
+	{
+	public:
+
+		virtual ~LogSink() = default;
+
+		virtual void write(std::string_view text) = 0;
+		virtual void flush() {}
+
+	};
+
+	UZE void addLogSink(std::shared_ptr<LogSink> sink);
+	UZE void removeLogSink(const std::shared_ptr<LogSink>& sink);
+
+	class UZE StreamLogSink final : public LogSink
+	{
+	public:
+
+		explicit StreamLogSink(std::ostream& out) : m_out(out) {}
+
+		void write(std::string_view text) override;
+		void flush() override;
+
+	private:
+
+		std::ostream& m_out;
+
+	};
+
+	// Starts a new file when the current one would grow over max_size. Previous files are renamed
+	// to `path.1`, `path.2`, ..., the oldest of max_backups files is deleted
+	class UZE RotatingFileLogSink final : public LogSink
+	{
+	public:
+
+		RotatingFileLogSink(std::filesystem::path path, u64 max_size, u32 max_backups = 3);
+
+		void write(std::string_view text) override;
+		void flush() override;
+
+		bool isOpen() const { return m_file.is_open(); }
+
+	private:
+
+		std::filesystem::path m_path;
+		u64 m_max_size;
+		u32 m_max_backups;
+		std::ofstream m_file;
+		u64 m_size{ 0 };
+
+		void rotate();
+
+	};
+
+	// Keeps the last `capacity` bytes of the log, e.g. to put them into a crash report
+	class UZE MemoryLogSink final : public LogSink
+	{
+	public:
+
+		explicit MemoryLogSink(u64 capacity);
+
+		void write(std::string_view text) override;
+
+		// Oldest text first, starts at a line boundary once the buffer has wrapped around
+		std::string getContents() const;
+
+	private:
+
+		mutable std::mutex m_mutex;
+		std::string m_buffer;
+		u64 m_position{ 0 };
+		bool m_wrapped{ false };
+
+	};
+
+}
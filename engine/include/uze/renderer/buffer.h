@@ -1,6 +1,7 @@
 #pragma once
 
 #include "uze/common.h"
+#include <memory>
 #include <vector>
 #include <glm/vec2.hpp>
 #include <glm/vec4.hpp>
@@ -87,6 +88,9 @@ namespace uze
 		bool dynamic = false;
 		u32 size{ 0 };
 		void* data{ nullptr };
+		// Vertex buffers only. For data rewritten every frame, the buffer is split into this many
+		// regions which are written in turn through mapRegion
+		u32 num_stream_regions{ 0 };
 	};
 
 	class UZE VertexBuffer final : NonCopyable<VertexBuffer>
@@ -98,6 +102,17 @@ namespace uze
 		void updateData(const void* data, i64 size, i64 offset = 0);
 
 		bool isDynamic() const { return m_usage == 0x88E8; }
+		bool isStreaming() const { return m_num_regions != 0; }
+		u32 getRegionSize() const { return m_region_size; }
+
+		// Streaming buffers only. Returns memory for the next region, a fence makes sure the GPU isn't
+		// reading it anymore. On GL 3.3 the region is mapped directly, GLES and WebGL can't map
+		// buffers, so data goes to a staging copy and the buffer is orphaned on upload instead.
+		// The staging copy is also used when mapping fails, so the result is never null for streaming buffers
+		void* mapRegion();
+		// Finishes writing `size` bytes of the mapped region and returns its offset in the buffer.
+		// The region isn't used up when nothing was written
+		u64 unmapRegion(u64 size);
 
 	private:
 
@@ -106,6 +121,15 @@ namespace uze
 		u32 m_size{ 0 };
 		Renderer& m_renderer;
 
+		u32 m_num_regions{ 0 };
+		u32 m_region_size{ 0 };
+		u32 m_region{ 0 };
+		bool m_mapped{ false };
+		// Region written last, fenced once the draws using it are submitted
+		bool m_fence_pending{ false };
+		std::vector<void*> m_fences;
+		std::unique_ptr<u8[]> m_staging;
+
 		VertexBuffer(const BufferSpecification& spec, Renderer& renderer);
 
 		void bind();
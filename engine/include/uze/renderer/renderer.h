@@ -3,6 +3,7 @@
 #include "uze/renderer/shader.h"
 #include "uze/renderer/buffer.h"
 #include "uze/renderer/vertex_array.h"
+#include "uze/core/frame_statistics.h"
 #include <string>
 #include <unordered_map>
 #include "glm/glm.hpp"
@@ -20,9 +21,27 @@ namespace uze
 		u32 num_texture_units;
 	};
 
+	struct UZE RendererSpecification final
+	{
+		u32 width{ 1600 };
+		u32 height{ 900 };
+		bool vsync{ true };
+		// Renders into an offscreen framebuffer of width x height behind a hidden window, without V-Sync.
+		// Falls back to SDL's offscreen video driver (EGL) when there's no display, so with Mesa
+		// it also works on machines without a GPU through llvmpipe
+		bool headless{ false };
+		// Each quad is one 32 byte instance expanded to corners on the GPU, instead of four
+		// vertices transformed on the CPU
+		bool instanced_quads{ true };
+	};
+
 	struct UZE RendererStatistics final
 	{
 		double frame_time_ms{ 0.0 };
+		// Part of frame_time_ms spent in SDL_GL_SwapWindow, mostly waiting for V-Sync or the GPU
+		double swap_time_ms{ 0.0 };
+		// GPU time of the latest frame with finished timer queries, a few frames behind this one
+		double gpu_time_ms{ 0.0 };
 		u32 num_vertices{ 0 };
 		u32 num_quads{ 0 };
 		u32 num_draw_calls{ 0 };
@@ -41,16 +60,31 @@ namespace uze
 		friend class Renderer;
 	};
 
+	struct UZE GpuTiming final
+	{
+		const char* name;
+		// Number of enclosing scopes, the whole frame is 0
+		u32 depth;
+		double time_ms;
+	};
+
 	struct SceneData;
 	struct BatchData;
+	struct GpuTimerData;
 	class UZE Renderer final : NonCopyable<Renderer>
 	{
 	public:
 
-		Renderer();
+		explicit Renderer(const RendererSpecification& spec = {});
 		~Renderer();
 
 		bool isValid() const { return m_valid; }
+		bool isHeadless() const { return m_spec.headless; }
+		const RendererSpecification& getSpecification() const { return m_spec; }
+
+		// RGBA8 pixels of the last rendered frame, top row first. Meant for image comparison
+		// in tests, reading back stalls until the GPU is done
+		std::vector<u8> readPixels() const;
 
 		void clear(float r, float g, float b, float a);
 
@@ -59,14 +93,28 @@ namespace uze
 
 		const RenderingCapabilities& getCapabilities() const { return m_caps; }
 		const RendererStatistics& getStatistics() const { return m_stats; }
+		const FrameStatistics& getFrameStatistics() const { return m_frame_stats; }
+		FrameStatistics& getFrameStatistics() { return m_frame_stats; }
 
 		void bindShader(const Shader& shader);
 		void draw(const VertexArray& vertex_array);
-		void draw(const VertexArray& vertex_array, i32 num_indices);
+		// Base vertex is added to each index, ignored on GLES where the data always starts at 0
+		void draw(const VertexArray& vertex_array, i32 num_indices, i32 base_vertex = 0);
+		// Draws all indices of the vertex array num_instances times
+		void drawInstanced(const VertexArray& vertex_array, i32 num_instances);
 
 		void drawQuad(glm::vec2 position, const glm::vec4& color);
 		void drawQuad(const glm::mat4& transform, const glm::vec4& color);
 
+		// GPU time of the commands in between is measured with timestamp queries, scopes can nest.
+		// Name must stay valid for a few frames, string literals are expected
+		void beginGpuScope(const char* name);
+		void endGpuScope();
+		// Scopes of the latest frame with finished queries. Results are read a few frames later,
+		// so measuring never waits for the GPU
+		const std::vector<GpuTiming>& getGpuTimings() const;
+		bool isGpuTimingSupported() const;
+
 		std::shared_ptr<Shader> createShader(const ShaderSpecification& spec);
 		std::shared_ptr<Shader> createShader(std::string_view source);
 		std::shared_ptr<VertexBuffer> createVertexBuffer(const BufferSpecification& spec);
@@ -95,13 +143,23 @@ namespace uze
 		SDL_Window* m_window{ nullptr };
 		void* m_gl_context{ nullptr };
 		bool m_valid{ false };
+		RendererSpecification m_spec;
+
+		// Offscreen target of headless mode
+		u32 m_framebuffer{ 0 };
+		u32 m_color_renderbuffer{ 0 };
+		u32 m_depth_renderbuffer{ 0 };
 		RenderingCapabilities m_caps;
 		RendererStatistics m_stats;
+		FrameStatistics m_frame_stats;
 
 		Stopwatch m_sw;
+		// Reset at the end of every frame
+		Stopwatch m_frame_sw;
 
 		std::unique_ptr<SceneData> m_scene_data{ nullptr };
 		std::unique_ptr<BatchData> m_batch_data{ nullptr };
+		std::unique_ptr<GpuTimerData> m_gpu_timer_data{ nullptr };
 		std::unordered_map<std::string, std::unique_ptr<ShaderPreprocessor>> m_shader_preprocessors;
 
 		std::shared_ptr<UniformBuffer> m_scene_buffer{ nullptr };
@@ -112,6 +170,10 @@ namespace uze
 		void endBatch();
 		void nextBatch();
 
+		void resolveGpuTimers();
+		bool createFramebuffer();
+		void getFramebufferSize(i32& width, i32& height) const;
+
 		void registerShaderPreprocessorImpl(std::unique_ptr<ShaderPreprocessor> pp);
 		void registerUniformBuffersForShader(const Shader& shader);
 
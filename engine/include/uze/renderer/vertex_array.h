@@ -14,13 +14,26 @@ namespace uze
 		const std::vector<std::shared_ptr<VertexBuffer>>& getVertexBuffers() const { return m_vertex_buffers; }
 		const std::shared_ptr<IndexBuffer>& getIndexBuffer() const { return m_index_buffer; }
 
-		void addVertexBuffer(const std::shared_ptr<VertexBuffer>& buffer, const VertexLayout& layout);
+		// Attributes advance once per divisor instances, or once per vertex when it's 0
+		void addVertexBuffer(const std::shared_ptr<VertexBuffer>& buffer, const VertexLayout& layout, u32 divisor = 0);
 		void setIndexBuffer(const std::shared_ptr<IndexBuffer>& buffer);
 
+		// Makes attributes of the buffer start `offset` bytes into it. GL 3.3 has no base instance,
+		// so instanced data in the middle of a buffer can only be drawn this way
+		void setVertexBufferOffset(VertexBuffer& buffer, u64 offset);
+
 	private:
 
+		struct Binding
+		{
+			const VertexBuffer* buffer;
+			VertexLayout layout;
+			u32 first_attribute;
+		};
+
 		u32 m_handle{ 0 };
 		u32 m_attribute_index{ 0 };
+		std::vector<Binding> m_bindings;
 		std::vector<std::shared_ptr<VertexBuffer>> m_vertex_buffers{ nullptr };
 		std::shared_ptr<IndexBuffer> m_index_buffer{ nullptr };
 
@@ -3,13 +3,27 @@
 #if UZE_PLATFORM != UZE_PLATFORM_WEB
 
 #include "uze/core/file_system.h"
+#include "uze/core/profiler.h"
 #include <fstream>
+#include <string>
+
+#if UZE_PLATFORM == UZE_PLATFORM_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace uze::fs
 {
 
 	Buffer getFileContents(std::string_view file)
 	{
+		UZE_PROFILE_SCOPE("fs::getFileContents");
 		const std::ios::openmode flags = std::ios::in | std::ios::ate | std::ios::binary;
 
 		std::fstream in(file.data(), flags);
@@ -25,6 +39,127 @@ namespace uze::fs
 		return data;
 	}
 
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+		: m_data(other.m_data), m_size(other.m_size), m_handle(other.m_handle)
+	{
+		other.m_data = nullptr;
+		other.m_size = 0;
+		other.m_handle = nullptr;
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (this == &other)
+			return *this;
+
+		release();
+		m_data = other.m_data;
+		m_size = other.m_size;
+		m_handle = other.m_handle;
+		other.m_data = nullptr;
+		other.m_size = 0;
+		other.m_handle = nullptr;
+		return *this;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		release();
+	}
+
+#if UZE_PLATFORM == UZE_PLATFORM_WINDOWS
+
+	void MappedFile::release()
+	{
+		if (m_data)
+			UnmapViewOfFile(m_data);
+		if (m_handle)
+			CloseHandle(m_handle);
+
+		m_data = nullptr;
+		m_size = 0;
+		m_handle = nullptr;
+	}
+
+	MappedFile mapFile(std::string_view file)
+	{
+		UZE_PROFILE_SCOPE("fs::mapFile");
+		MappedFile result;
+
+		const std::string path(file);
+		HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (handle == INVALID_HANDLE_VALUE)
+			return result;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0)
+		{
+			CloseHandle(handle);
+			return result;
+		}
+
+		// The mapping object keeps the file open
+		HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(handle);
+		if (!mapping)
+			return result;
+
+		const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!data)
+		{
+			CloseHandle(mapping);
+			return result;
+		}
+
+		result.m_data = static_cast<const u8*>(data);
+		result.m_size = static_cast<u64>(size.QuadPart);
+		result.m_handle = mapping;
+		return result;
+	}
+
+#else
+
+	void MappedFile::release()
+	{
+		if (m_data)
+			munmap(const_cast<u8*>(m_data), m_size);
+
+		m_data = nullptr;
+		m_size = 0;
+		m_handle = nullptr;
+	}
+
+	MappedFile mapFile(std::string_view file)
+	{
+		UZE_PROFILE_SCOPE("fs::mapFile");
+		MappedFile result;
+
+		const std::string path(file);
+		const int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return result;
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0)
+		{
+			close(fd);
+			return result;
+		}
+
+		// The mapping stays valid after the descriptor is closed
+		void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (data == MAP_FAILED)
+			return result;
+
+		result.m_data = static_cast<const u8*>(data);
+		result.m_size = static_cast<u64>(st.st_size);
+		return result;
+	}
+
+#endif
+
 }
 
-#endif
\ No newline at end of file
+#endif
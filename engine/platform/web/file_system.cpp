@@ -3,7 +3,10 @@
 #if UZE_PLATFORM == UZE_PLATFORM_WEB
 
 #include "uze/core/file_system.h"
+#include "uze/core/profiler.h"
 #include <emscripten.h>
+#include <cstdlib>
+#include <cstring>
 
 EM_JS(char*, js_loadFile, (const char* name, int* fileSize),
 {
@@ -21,13 +24,74 @@ namespace uze::fs
 
 	Buffer getFileContents(std::string_view file)
 	{
+		UZE_PROFILE_SCOPE("fs::getFileContents");
 		int size = 0;
 		char* data = js_loadFile(file.data(), &size);
-		Buffer buf(size);
-		buf.data = data;
+		if (!data)
+			return {};
+
+		// Buffer memory is released with delete[], the file is loaded with malloc
+		Buffer buf(static_cast<u64>(size));
+		std::memcpy(buf.data, data, buf.size);
+		std::free(data);
 		return buf;
 	}
 
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+		: m_data(other.m_data), m_size(other.m_size), m_handle(other.m_handle)
+	{
+		other.m_data = nullptr;
+		other.m_size = 0;
+		other.m_handle = nullptr;
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (this == &other)
+			return *this;
+
+		release();
+		m_data = other.m_data;
+		m_size = other.m_size;
+		m_handle = other.m_handle;
+		other.m_data = nullptr;
+		other.m_size = 0;
+		other.m_handle = nullptr;
+		return *this;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		release();
+	}
+
+	void MappedFile::release()
+	{
+		std::free(m_handle);
+
+		m_data = nullptr;
+		m_size = 0;
+		m_handle = nullptr;
+	}
+
+	// There's no memory mapping on web, the file is read into memory owned by MappedFile
+	// and freed in release()
+	MappedFile mapFile(std::string_view file)
+	{
+		UZE_PROFILE_SCOPE("fs::mapFile");
+		MappedFile result;
+
+		int size = 0;
+		char* data = js_loadFile(file.data(), &size);
+		if (!data)
+			return result;
+
+		result.m_data = reinterpret_cast<const u8*>(data);
+		result.m_size = static_cast<u64>(size);
+		result.m_handle = data;
+		return result;
+	}
+
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "uze/common.h"
+#include <fmt/format.h>
+#include <atomic>
+#include <iterator>
+#include <string_view>
+
+// Shared by logging and the profiler, so thread indices of log records and trace events match
+namespace uze::diagnostics
+{
+
+	// Small index of the calling thread, in order of the first call
+	inline u32 getThreadIndex()
+	{
+		static std::atomic<u32> s_next_thread_index{ 0 };
+		static thread_local const u32 t_thread_index = s_next_thread_index.fetch_add(1, std::memory_order_relaxed);
+		return t_thread_index;
+	}
+
+	inline void appendJsonString(fmt::memory_buffer& out, std::string_view str)
+	{
+		out.push_back('"');
+		for (const char c : str)
+		{
+			switch (c)
+			{
+			case '"': out.append(std::string_view("\\\"")); break;
+			case '\\': out.append(std::string_view("\\\\")); break;
+			case '\n': out.append(std::string_view("\\n")); break;
+			case '\r': out.append(std::string_view("\\r")); break;
+			case '\t': out.append(std::string_view("\\t")); break;
+			default:
+				if (static_cast<u8>(c) < 0x20)
+					fmt::format_to(std::back_inserter(out), "\\u{:04x}", static_cast<u32>(c));
+				else
+					out.push_back(c);
+			}
+		}
+		out.push_back('"');
+	}
+
+}
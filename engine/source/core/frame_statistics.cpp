@@ -0,0 +1,157 @@
+#include "uze/core/frame_statistics.h"
+#include <fmt/format.h>
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+
+namespace uze
+{
+
+	namespace
+	{
+
+		double getComponent(const FrameTiming& timing, FrameTimeComponent component)
+		{
+			switch (component)
+			{
+				default:
+				case FrameTimeComponent::Frame: return timing.frame_ms;
+				case FrameTimeComponent::Cpu: return timing.cpu_ms;
+				case FrameTimeComponent::Gpu: return timing.gpu_ms;
+				case FrameTimeComponent::Swap: return timing.swap_ms;
+			}
+		}
+
+		// Nearest rank, times must be sorted
+		double getPercentile(const std::vector<double>& times, double percentile)
+		{
+			const auto rank = static_cast<u64>(std::ceil(percentile * 0.01 * static_cast<double>(times.size())));
+			return times[std::max<u64>(rank, 1) - 1];
+		}
+
+	}
+
+	FrameStatistics::FrameStatistics(u64 window_size)
+		: m_frames(std::max<u64>(window_size, 1))
+	{
+	}
+
+	void FrameStatistics::addFrame(const FrameTiming& timing)
+	{
+		// Average of recent frames reacts within a few dozen frames, so a slow scene isn't a stream of hitches
+		const bool hitch = m_total_frames > 0 && timing.frame_ms >= m_hitch_min_ms
+			&& timing.frame_ms > m_hitch_factor * m_recent_average_ms;
+		m_recent_average_ms = m_total_frames > 0
+			? m_recent_average_ms + (timing.frame_ms - m_recent_average_ms) * 0.05
+			: timing.frame_ms;
+
+		m_frames[m_next] = { timing, hitch };
+		m_next = (m_next + 1) % m_frames.size();
+		m_count = std::min<u64>(m_count + 1, m_frames.size());
+
+		++m_total_frames;
+		m_total_hitches += hitch;
+		const auto bucket = static_cast<u64>(std::max(timing.frame_ms, 0.0));
+		++m_histogram[std::min(bucket, num_histogram_buckets - 1)];
+	}
+
+	void FrameStatistics::setGpuTime(u64 frame_number, double gpu_ms)
+	{
+		if (frame_number >= m_total_frames)
+			return;
+
+		const u64 age = m_total_frames - 1 - frame_number;
+		if (age < m_count)
+			m_frames[(m_next + m_frames.size() - 1 - age) % m_frames.size()].timing.gpu_ms = gpu_ms;
+	}
+
+	void FrameStatistics::reset()
+	{
+		m_next = 0;
+		m_count = 0;
+		m_total_frames = 0;
+		m_total_hitches = 0;
+		m_histogram.fill(0);
+		m_recent_average_ms = 0.0;
+	}
+
+	void FrameStatistics::setWindowSize(u64 window_size)
+	{
+		std::vector<Frame> frames(std::max<u64>(window_size, 1));
+		const u64 count = std::min<u64>(m_count, frames.size());
+		// Keeps the most recent frames, oldest first
+		for (u64 n = 0; n < count; ++n)
+			frames[n] = getFrame(count - 1 - n);
+
+		m_frames = std::move(frames);
+		m_count = count;
+		m_next = count % m_frames.size();
+	}
+
+	void FrameStatistics::setHitchThreshold(double hitch_factor, double hitch_min_ms)
+	{
+		m_hitch_factor = hitch_factor;
+		m_hitch_min_ms = hitch_min_ms;
+	}
+
+	FrameTimeSummary FrameStatistics::getSummary(FrameTimeComponent component, u64 num_frames) const
+	{
+		FrameTimeSummary summary;
+		summary.num_frames = std::min(num_frames, m_count);
+		if (!summary.num_frames)
+			return summary;
+
+		std::vector<double> times;
+		times.reserve(summary.num_frames);
+		double total = 0.0;
+		for (u64 age = 0; age < summary.num_frames; ++age)
+		{
+			const auto& frame = getFrame(age);
+			times.push_back(getComponent(frame.timing, component));
+			total += times.back();
+			summary.num_hitches += frame.hitch;
+		}
+		std::sort(times.begin(), times.end());
+
+		summary.min_ms = times.front();
+		summary.max_ms = times.back();
+		summary.average_ms = total / static_cast<double>(times.size());
+		summary.p50_ms = getPercentile(times, 50.0);
+		summary.p95_ms = getPercentile(times, 95.0);
+		summary.p99_ms = getPercentile(times, 99.0);
+		return summary;
+	}
+
+	const FrameTiming& FrameStatistics::getLastFrame() const
+	{
+		static const FrameTiming empty;
+		return m_count ? getFrame(0).timing : empty;
+	}
+
+	bool FrameStatistics::writeCsv(std::ostream& out) const
+	{
+		fmt::memory_buffer buffer;
+		auto it = std::back_inserter(buffer);
+
+		fmt::format_to(it, "frame,frame_ms,cpu_ms,gpu_ms,swap_ms,hitch\n");
+		for (u64 n = 0; n < m_count; ++n)
+		{
+			const u64 age = m_count - 1 - n;
+			const auto& [timing, hitch] = getFrame(age);
+			fmt::format_to(it, "{},{:.3f},{:.3f},{:.3f},{:.3f},{}\n", m_total_frames - 1 - age,
+				timing.frame_ms, timing.cpu_ms, timing.gpu_ms, timing.swap_ms, hitch ? 1 : 0);
+		}
+
+		fmt::format_to(it, "\nhistogram_ms,frames\n");
+		for (u64 bucket = 0; bucket < num_histogram_buckets; ++bucket)
+		{
+			if (m_histogram[bucket])
+				fmt::format_to(it, "{}{},{}\n", bucket, bucket + 1 == num_histogram_buckets ? "+" : "",
+					m_histogram[bucket]);
+		}
+
+		out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		return out.good();
+	}
+
+}
@@ -1,4 +1,5 @@
 #include "uze/core/job_system.h"
+#include "uze/core/profiler.h"
 #include <vector>
 #include <thread>
 #include <queue>
@@ -44,7 +45,8 @@ namespace uze
 	static std::queue<Job*> s_jobs;
 	static std::mutex s_job_mutex;
 
-	void workerThread();
+	void workerThread(u64 index);
+	static bool executeNextJob();
 #endif
 
 	void job_system::init()
@@ -57,14 +59,14 @@ namespace uze
 
 #if UZE_PLATFORM != UZE_PLATFORM_WEB
 		const auto max_threads = std::min(std::thread::hardware_concurrency(), 8u);
-		const auto num_threads = max_threads == 0 ? 1 : std::max(max_threads - 2u, 1u);
+		const auto num_threads = max_threads > 2 ? max_threads - 2u : 1u;
 		uzLog(log_job_system, Info, "Creating {} worker threads", num_threads);
 		s_workers.reserve(num_threads);
 
 		for (u64 i = 0; i < num_threads; ++i)
 		{
 			auto worker = std::make_unique<Worker>();
-			worker->thread = std::thread(workerThread);
+			worker->thread = std::thread(workerThread, i);
 			s_workers.push_back(std::move(worker));
 		}
 #else
@@ -96,6 +98,7 @@ namespace uze
 			s_jobs.push(&job);
 		}
 #else
+		UZE_PROFILE_SCOPE("Job");
 		job.status = JobStatus::InProgress;
 		job.result = job.func();
 		job.status = JobStatus::Finished;
@@ -128,6 +131,42 @@ namespace uze
 #endif
 	}
 
+	void job_system::parallelFor(u64 count, const std::function<void(u64)>& func)
+	{
+		UZE_PROFILE_SCOPE("parallelFor");
+		if (!s_executing || count < 2)
+		{
+			for (u64 i = 0; i < count; ++i)
+				func(i);
+			return;
+		}
+
+		std::vector<std::unique_ptr<Job>> jobs;
+		jobs.reserve(count);
+		for (u64 i = 0; i < count; ++i)
+		{
+			jobs.push_back(std::make_unique<Job>([&func, i]()
+			{
+				func(i);
+				return JobResult::Success;
+			}));
+			submit(*jobs.back());
+		}
+
+		for (const auto& job : jobs)
+		{
+#if UZE_PLATFORM != UZE_PLATFORM_WEB
+			while (job->status != JobStatus::Finished)
+			{
+				if (!executeNextJob())
+					std::this_thread::yield();
+			}
+#else
+			job->wait();
+#endif
+		}
+	}
+
 	u64 job_system::getNumWorkerThreads()
 	{
 #if UZE_PLATFORM != UZE_PLATFORM_WEB
@@ -150,26 +189,34 @@ namespace uze
 	}
 
 #if UZE_PLATFORM != UZE_PLATFORM_WEB
-	void workerThread()
+	static bool executeNextJob()
 	{
-		while (s_executing)
+		s_job_mutex.lock();
+
+		if (s_jobs.empty())
 		{
-			s_job_mutex.lock();
+			s_job_mutex.unlock();
+			return false;
+		}
 
-			if (s_jobs.empty())
-			{
-				s_job_mutex.unlock();
-				std::this_thread::yield();
-				continue;
-			}
+		auto job = s_jobs.front();
+		s_jobs.pop();
+		s_job_mutex.unlock();
 
-			auto job = s_jobs.front();
-			s_jobs.pop();
-			s_job_mutex.unlock();
+		UZE_PROFILE_SCOPE("Job");
+		job->status = JobStatus::InProgress;
+		job->result = job->func();
+		job->status = JobStatus::Finished;
+		return true;
+	}
 
-			job->status = JobStatus::InProgress;
-			job->result = job->func();
-			job->status = JobStatus::Finished;
+	void workerThread(u64 index)
+	{
+		profiler::setThreadName(fmt::format("Worker {}", index));
+		while (s_executing)
+		{
+			if (!executeNextJob())
+				std::this_thread::yield();
 		}
 	}
 #endif
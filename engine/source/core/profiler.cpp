@@ -0,0 +1,228 @@
+#include "uze/core/profiler.h"
+#include "diagnostics.h"
+#include <fmt/format.h>
+#include <algorithm>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace uze
+{
+
+	std::atomic<bool> uzProfile_capturing{ false };
+
+	static constexpr LogCategory log_profiler { "Profiler" };
+
+	using diagnostics::appendJsonString;
+	using diagnostics::getThreadIndex;
+
+	namespace
+	{
+
+		struct Zone
+		{
+			const char* name;
+			u64 begin;
+			u64 end;
+		};
+
+		// Single producer, single consumer. Positions grow monotonically and are masked on access
+		struct ZoneRing
+		{
+			ZoneRing(u64 capacity_, u32 thread_) : capacity(capacity_), zones(new Zone[capacity_]), thread(thread_) {}
+
+			const u64 capacity;
+			const std::unique_ptr<Zone[]> zones;
+			const u32 thread;
+
+			alignas(64) std::atomic<u64> head{ 0 };
+			// Owned by the producer
+			u64 cached_tail{ 0 };
+			std::atomic<u64> dropped{ 0 };
+			std::atomic<bool> abandoned{ false };
+
+			alignas(64) std::atomic<u64> tail{ 0 };
+		};
+
+		struct CapturedZone
+		{
+			Zone zone;
+			u32 thread;
+		};
+
+		std::mutex s_mutex;
+		std::vector<std::shared_ptr<ZoneRing>> s_rings;
+		std::vector<CapturedZone> s_zones;
+		std::vector<std::pair<u32, std::string>> s_thread_names;
+		u64 s_capture_start{ 0 };
+		u64 s_dropped{ 0 };
+		std::atomic<u64> s_ring_capacity{ 1 << 15 };
+
+		struct RingHandle
+		{
+			std::shared_ptr<ZoneRing> ring;
+
+			~RingHandle()
+			{
+				// Released by collect once drained
+				if (ring)
+					ring->abandoned.store(true, std::memory_order_release);
+			}
+		};
+
+		thread_local RingHandle t_ring;
+
+		ZoneRing& getThreadRing()
+		{
+			if (!t_ring.ring)
+			{
+				const u64 requested = s_ring_capacity.load(std::memory_order_relaxed);
+				u64 capacity = 256;
+				while (capacity < requested)
+					capacity *= 2;
+
+				t_ring.ring = std::make_shared<ZoneRing>(capacity, getThreadIndex());
+				std::scoped_lock lock(s_mutex);
+				s_rings.push_back(t_ring.ring);
+			}
+			return *t_ring.ring;
+		}
+
+		// Moves zones of every ring into the capture, or throws them away. Expects s_mutex to be locked
+		void drainRings(bool keep)
+		{
+			for (auto it = s_rings.begin(); it != s_rings.end();)
+			{
+				auto& ring = **it;
+				const bool abandoned = ring.abandoned.load(std::memory_order_acquire);
+				const u64 head = ring.head.load(std::memory_order_acquire);
+				u64 tail = ring.tail.load(std::memory_order_relaxed);
+
+				if (keep)
+				{
+					for (; tail != head; ++tail)
+						s_zones.push_back({ ring.zones[tail & (ring.capacity - 1)], ring.thread });
+				}
+				ring.tail.store(head, std::memory_order_release);
+				const u64 dropped = ring.dropped.exchange(0, std::memory_order_relaxed);
+				if (keep)
+					s_dropped += dropped;
+
+				if (abandoned)
+					it = s_rings.erase(it);
+				else
+					++it;
+			}
+		}
+
+	}
+
+	void profiler::startCapture(u64 events_per_thread)
+	{
+		std::scoped_lock lock(s_mutex);
+		s_ring_capacity.store(events_per_thread, std::memory_order_relaxed);
+		drainRings(false);
+		s_zones.clear();
+		s_dropped = 0;
+		s_capture_start = now();
+		uzProfile_capturing.store(true, std::memory_order_relaxed);
+		uzLog(log_profiler, Info, "Capture started");
+	}
+
+	void profiler::stopCapture()
+	{
+		if (!uzProfile_capturing.exchange(false, std::memory_order_relaxed))
+			return;
+
+		collect();
+		std::scoped_lock lock(s_mutex);
+		uzLog(log_profiler, Info, "Capture stopped, {} zones, {} dropped", s_zones.size(), s_dropped);
+	}
+
+	void profiler::collect()
+	{
+		std::scoped_lock lock(s_mutex);
+		drainRings(true);
+	}
+
+	u64 profiler::getNumDroppedZones()
+	{
+		std::scoped_lock lock(s_mutex);
+		return s_dropped;
+	}
+
+	bool profiler::writeChromeTrace(std::ostream& out)
+	{
+		collect();
+
+		fmt::memory_buffer buffer;
+		auto it = std::back_inserter(buffer);
+		std::scoped_lock lock(s_mutex);
+
+		fmt::format_to(it, "{{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+		bool first = true;
+		for (const auto& [thread, name] : s_thread_names)
+		{
+			fmt::format_to(it, "{}{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":{},\"args\":{{\"name\":",
+				first ? "" : ",\n", thread);
+			appendJsonString(buffer, name);
+			fmt::format_to(it, "}}}}");
+			first = false;
+		}
+
+		for (const auto& [zone, thread] : s_zones)
+		{
+			// Ended before the capture, but weren't drained until it started
+			if (zone.end < s_capture_start)
+				continue;
+
+			// Zones still open when the capture started begin before it
+			const u64 begin = std::max(zone.begin, s_capture_start) - s_capture_start;
+			const u64 duration = zone.end - std::max(zone.begin, s_capture_start);
+			fmt::format_to(it, "{}{{\"name\":", first ? "" : ",\n");
+			appendJsonString(buffer, zone.name);
+			fmt::format_to(it, ",\"ph\":\"X\",\"pid\":0,\"tid\":{},\"ts\":{}.{:03},\"dur\":{}.{:03}}}",
+				thread, begin / 1000, begin % 1000, duration / 1000, duration % 1000);
+			first = false;
+		}
+		fmt::format_to(it, "\n]}}\n");
+
+		out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		return out.good();
+	}
+
+	void profiler::setThreadName(std::string_view name)
+	{
+		const u32 thread = getThreadIndex();
+		std::scoped_lock lock(s_mutex);
+		for (auto& [index, thread_name] : s_thread_names)
+		{
+			if (index == thread)
+			{
+				thread_name = name;
+				return;
+			}
+		}
+		s_thread_names.emplace_back(thread, name);
+	}
+
+	void profiler::recordZone(const char* name, u64 begin, u64 end)
+	{
+		auto& ring = getThreadRing();
+		const u64 head = ring.head.load(std::memory_order_relaxed);
+		if (head - ring.cached_tail >= ring.capacity)
+		{
+			ring.cached_tail = ring.tail.load(std::memory_order_acquire);
+			if (head - ring.cached_tail >= ring.capacity)
+			{
+				ring.dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+		}
+
+		ring.zones[head & (ring.capacity - 1)] = { name, begin, end };
+		ring.head.store(head + 1, std::memory_order_release);
+	}
+
+}
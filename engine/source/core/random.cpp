@@ -1,41 +1,474 @@
 #include "uze/core/random.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define UZE_RANDOM_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define UZE_RANDOM_SSE2 1
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define UZE_RANDOM_WASM_SIMD 1
+#endif
 
 namespace uze
 {
 
-	Random::Random() : Random(std::random_device()())
+	u64 makeRandomSeed()
 	{
+		std::random_device device;
+		return (static_cast<u64>(device()) << 32) | device();
 	}
 
-	Random::Random(u32 seed) : m_random_number_generator(seed)
+	namespace
 	{
-	}
 
-	i32 Random::next()
-	{
-		return next(0, std::numeric_limits<i32>::max());
+		constexpr u64 num_lanes = 4;
+		// Every step of the lanes gives two floats per lane, low halves of the lanes first
+		constexpr u64 block_size = num_lanes * 2;
+
+		// xoshiro256** state of every lane, word-major so a word of all lanes is loaded at once
+		struct alignas(32) BatchState
+		{
+			u64 words[4][num_lanes];
+
+			explicit BatchState(u64 seed)
+			{
+				SplitMix64 seeder(seed);
+				for (u64 lane = 0; lane < num_lanes; ++lane)
+				{
+					for (auto& word : words)
+						word[lane] = seeder.nextU64();
+				}
+			}
+		};
+
+		// Writes num_blocks * block_size values of f * scale + bias, where f is uniform in [1, 2)
+		void fillBlocks(BatchState& state, float* out, u64 num_blocks, float scale, float bias)
+		{
+#if defined(UZE_RANDOM_AVX2)
+			__m256i s0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(state.words[0]));
+			__m256i s1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(state.words[1]));
+			__m256i s2 = _mm256_load_si256(reinterpret_cast<const __m256i*>(state.words[2]));
+			__m256i s3 = _mm256_load_si256(reinterpret_cast<const __m256i*>(state.words[3]));
+			const __m256i halves_order = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+			const __m256i one = _mm256_set1_epi32(0x3f800000);
+			const __m256 scale_v = _mm256_set1_ps(scale);
+			const __m256 bias_v = _mm256_set1_ps(bias);
+
+			for (u64 block = 0; block < num_blocks; ++block)
+			{
+				// Multiplications by 5 and 9 are shifts and adds, there's no 64-bit multiply before AVX-512
+				const __m256i x = _mm256_add_epi64(_mm256_slli_epi64(s1, 2), s1);
+				const __m256i rotated = _mm256_or_si256(_mm256_slli_epi64(x, 7), _mm256_srli_epi64(x, 57));
+				const __m256i result = _mm256_add_epi64(_mm256_slli_epi64(rotated, 3), rotated);
+				const __m256i t = _mm256_slli_epi64(s1, 17);
+
+				s2 = _mm256_xor_si256(s2, s0);
+				s3 = _mm256_xor_si256(s3, s1);
+				s1 = _mm256_xor_si256(s1, s2);
+				s0 = _mm256_xor_si256(s0, s3);
+				s2 = _mm256_xor_si256(s2, t);
+				s3 = _mm256_or_si256(_mm256_slli_epi64(s3, 45), _mm256_srli_epi64(s3, 19));
+
+				const __m256i halves = _mm256_permutevar8x32_epi32(result, halves_order);
+				const __m256 values = _mm256_castsi256_ps(_mm256_or_si256(_mm256_srli_epi32(halves, 9), one));
+				_mm256_storeu_ps(out + block * block_size, _mm256_add_ps(_mm256_mul_ps(values, scale_v), bias_v));
+			}
+
+			_mm256_store_si256(reinterpret_cast<__m256i*>(state.words[0]), s0);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(state.words[1]), s1);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(state.words[2]), s2);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(state.words[3]), s3);
+#elif defined(UZE_RANDOM_SSE2)
+			// Lanes 0-1 and 2-3
+			__m128i s[4][2];
+			for (u64 word = 0; word < 4; ++word)
+			{
+				s[word][0] = _mm_load_si128(reinterpret_cast<const __m128i*>(state.words[word]));
+				s[word][1] = _mm_load_si128(reinterpret_cast<const __m128i*>(state.words[word] + 2));
+			}
+			const __m128i one = _mm_set1_epi32(0x3f800000);
+			const __m128 scale_v = _mm_set1_ps(scale);
+			const __m128 bias_v = _mm_set1_ps(bias);
+
+			for (u64 block = 0; block < num_blocks; ++block)
+			{
+				__m128i result[2];
+				for (u64 half = 0; half < 2; ++half)
+				{
+					auto& s0 = s[0][half];
+					auto& s1 = s[1][half];
+					auto& s2 = s[2][half];
+					auto& s3 = s[3][half];
+
+					const __m128i x = _mm_add_epi64(_mm_slli_epi64(s1, 2), s1);
+					const __m128i rotated = _mm_or_si128(_mm_slli_epi64(x, 7), _mm_srli_epi64(x, 57));
+					result[half] = _mm_add_epi64(_mm_slli_epi64(rotated, 3), rotated);
+					const __m128i t = _mm_slli_epi64(s1, 17);
+
+					s2 = _mm_xor_si128(s2, s0);
+					s3 = _mm_xor_si128(s3, s1);
+					s1 = _mm_xor_si128(s1, s2);
+					s0 = _mm_xor_si128(s0, s3);
+					s2 = _mm_xor_si128(s2, t);
+					s3 = _mm_or_si128(_mm_slli_epi64(s3, 45), _mm_srli_epi64(s3, 19));
+				}
+
+				const __m128 r01 = _mm_castsi128_ps(result[0]);
+				const __m128 r23 = _mm_castsi128_ps(result[1]);
+				const __m128i low = _mm_castps_si128(_mm_shuffle_ps(r01, r23, _MM_SHUFFLE(2, 0, 2, 0)));
+				const __m128i high = _mm_castps_si128(_mm_shuffle_ps(r01, r23, _MM_SHUFFLE(3, 1, 3, 1)));
+				const __m128 low_values = _mm_castsi128_ps(_mm_or_si128(_mm_srli_epi32(low, 9), one));
+				const __m128 high_values = _mm_castsi128_ps(_mm_or_si128(_mm_srli_epi32(high, 9), one));
+
+				float* block_out = out + block * block_size;
+				_mm_storeu_ps(block_out, _mm_add_ps(_mm_mul_ps(low_values, scale_v), bias_v));
+				_mm_storeu_ps(block_out + num_lanes, _mm_add_ps(_mm_mul_ps(high_values, scale_v), bias_v));
+			}
+
+			for (u64 word = 0; word < 4; ++word)
+			{
+				_mm_store_si128(reinterpret_cast<__m128i*>(state.words[word]), s[word][0]);
+				_mm_store_si128(reinterpret_cast<__m128i*>(state.words[word] + 2), s[word][1]);
+			}
+#elif defined(UZE_RANDOM_WASM_SIMD)
+			v128_t s[4][2];
+			for (u64 word = 0; word < 4; ++word)
+			{
+				s[word][0] = wasm_v128_load(state.words[word]);
+				s[word][1] = wasm_v128_load(state.words[word] + 2);
+			}
+			const v128_t one = wasm_i32x4_splat(0x3f800000);
+			const v128_t scale_v = wasm_f32x4_splat(scale);
+			const v128_t bias_v = wasm_f32x4_splat(bias);
+
+			for (u64 block = 0; block < num_blocks; ++block)
+			{
+				v128_t result[2];
+				for (u64 half = 0; half < 2; ++half)
+				{
+					auto& s0 = s[0][half];
+					auto& s1 = s[1][half];
+					auto& s2 = s[2][half];
+					auto& s3 = s[3][half];
+
+					const v128_t x = wasm_i64x2_add(wasm_i64x2_shl(s1, 2), s1);
+					const v128_t rotated = wasm_v128_or(wasm_i64x2_shl(x, 7), wasm_u64x2_shr(x, 57));
+					result[half] = wasm_i64x2_add(wasm_i64x2_shl(rotated, 3), rotated);
+					const v128_t t = wasm_i64x2_shl(s1, 17);
+
+					s2 = wasm_v128_xor(s2, s0);
+					s3 = wasm_v128_xor(s3, s1);
+					s1 = wasm_v128_xor(s1, s2);
+					s0 = wasm_v128_xor(s0, s3);
+					s2 = wasm_v128_xor(s2, t);
+					s3 = wasm_v128_or(wasm_i64x2_shl(s3, 45), wasm_u64x2_shr(s3, 19));
+				}
+
+				const v128_t low = wasm_i32x4_shuffle(result[0], result[1], 0, 2, 4, 6);
+				const v128_t high = wasm_i32x4_shuffle(result[0], result[1], 1, 3, 5, 7);
+				const v128_t low_values = wasm_v128_or(wasm_u32x4_shr(low, 9), one);
+				const v128_t high_values = wasm_v128_or(wasm_u32x4_shr(high, 9), one);
+
+				float* block_out = out + block * block_size;
+				wasm_v128_store(block_out, wasm_f32x4_add(wasm_f32x4_mul(low_values, scale_v), bias_v));
+				wasm_v128_store(block_out + num_lanes, wasm_f32x4_add(wasm_f32x4_mul(high_values, scale_v), bias_v));
+			}
+
+			for (u64 word = 0; word < 4; ++word)
+			{
+				wasm_v128_store(state.words[word], s[word][0]);
+				wasm_v128_store(state.words[word] + 2, s[word][1]);
+			}
+#else
+			const auto rotl = [](u64 x, i32 k) { return (x << k) | (x >> (64 - k)); };
+			auto& [s0, s1, s2, s3] = state.words;
+
+			for (u64 block = 0; block < num_blocks; ++block)
+			{
+				float* block_out = out + block * block_size;
+				for (u64 lane = 0; lane < num_lanes; ++lane)
+				{
+					const u64 result = rotl(s1[lane] * 5, 7) * 9;
+					const u64 t = s1[lane] << 17;
+
+					s2[lane] ^= s0[lane];
+					s3[lane] ^= s1[lane];
+					s1[lane] ^= s2[lane];
+					s0[lane] ^= s3[lane];
+					s2[lane] ^= t;
+					s3[lane] = rotl(s3[lane], 45);
+
+					const u32 halves[2] = { static_cast<u32>(result), static_cast<u32>(result >> 32) };
+					for (u64 half = 0; half < 2; ++half)
+					{
+						const u32 bits = 0x3f800000u | (halves[half] >> 9);
+						float value;
+						std::memcpy(&value, &bits, sizeof(value));
+						block_out[half * num_lanes + lane] = value * scale + bias;
+					}
+				}
+			}
+#endif
+		}
+
+		void fillValues(BatchState& state, float* out, u64 count, float scale, float bias)
+		{
+			const u64 num_blocks = count / block_size;
+			fillBlocks(state, out, num_blocks, scale, bias);
+
+			if (const u64 rest = count % block_size)
+			{
+				float block[block_size];
+				fillBlocks(state, block, 1, scale, bias);
+				std::copy_n(block, rest, out + num_blocks * block_size);
+			}
+		}
+
+		// Float vectors of the enabled instruction set for the distribution transforms,
+		// the scalar fallback runs the same approximations one value at a time
+#if defined(UZE_RANDOM_AVX2)
+		using FloatV = __m256;
+		constexpr u64 float_width = 8;
+
+		inline FloatV loadV(const float* p) { return _mm256_load_ps(p); }
+		inline void storeV(float* p, FloatV v) { _mm256_store_ps(p, v); }
+		inline FloatV splat(float v) { return _mm256_set1_ps(v); }
+		inline FloatV add(FloatV a, FloatV b) { return _mm256_add_ps(a, b); }
+		inline FloatV sub(FloatV a, FloatV b) { return _mm256_sub_ps(a, b); }
+		inline FloatV mul(FloatV a, FloatV b) { return _mm256_mul_ps(a, b); }
+		inline FloatV div(FloatV a, FloatV b) { return _mm256_div_ps(a, b); }
+		inline FloatV sqrtV(FloatV v) { return _mm256_sqrt_ps(v); }
+		inline FloatV maxV(FloatV a, FloatV b) { return _mm256_max_ps(a, b); }
+
+		// Unbiased exponent and mantissa in [1, 2) of positive normal floats
+		inline FloatV exponentOf(FloatV v)
+		{
+			const __m256i bits = _mm256_srli_epi32(_mm256_castps_si256(v), 23);
+			return _mm256_cvtepi32_ps(_mm256_sub_epi32(bits, _mm256_set1_epi32(127)));
+		}
+
+		inline FloatV mantissaOf(FloatV v)
+		{
+			const __m256i bits = _mm256_and_si256(_mm256_castps_si256(v), _mm256_set1_epi32(0x007fffff));
+			return _mm256_castsi256_ps(_mm256_or_si256(bits, _mm256_set1_epi32(0x3f800000)));
+		}
+#elif defined(UZE_RANDOM_SSE2)
+		using FloatV = __m128;
+		constexpr u64 float_width = 4;
+
+		inline FloatV loadV(const float* p) { return _mm_load_ps(p); }
+		inline void storeV(float* p, FloatV v) { _mm_store_ps(p, v); }
+		inline FloatV splat(float v) { return _mm_set1_ps(v); }
+		inline FloatV add(FloatV a, FloatV b) { return _mm_add_ps(a, b); }
+		inline FloatV sub(FloatV a, FloatV b) { return _mm_sub_ps(a, b); }
+		inline FloatV mul(FloatV a, FloatV b) { return _mm_mul_ps(a, b); }
+		inline FloatV div(FloatV a, FloatV b) { return _mm_div_ps(a, b); }
+		inline FloatV sqrtV(FloatV v) { return _mm_sqrt_ps(v); }
+		inline FloatV maxV(FloatV a, FloatV b) { return _mm_max_ps(a, b); }
+
+		inline FloatV exponentOf(FloatV v)
+		{
+			const __m128i bits = _mm_srli_epi32(_mm_castps_si128(v), 23);
+			return _mm_cvtepi32_ps(_mm_sub_epi32(bits, _mm_set1_epi32(127)));
+		}
+
+		inline FloatV mantissaOf(FloatV v)
+		{
+			const __m128i bits = _mm_and_si128(_mm_castps_si128(v), _mm_set1_epi32(0x007fffff));
+			return _mm_castsi128_ps(_mm_or_si128(bits, _mm_set1_epi32(0x3f800000)));
+		}
+#elif defined(UZE_RANDOM_WASM_SIMD)
+		using FloatV = v128_t;
+		constexpr u64 float_width = 4;
+
+		inline FloatV loadV(const float* p) { return wasm_v128_load(p); }
+		inline void storeV(float* p, FloatV v) { wasm_v128_store(p, v); }
+		inline FloatV splat(float v) { return wasm_f32x4_splat(v); }
+		inline FloatV add(FloatV a, FloatV b) { return wasm_f32x4_add(a, b); }
+		inline FloatV sub(FloatV a, FloatV b) { return wasm_f32x4_sub(a, b); }
+		inline FloatV mul(FloatV a, FloatV b) { return wasm_f32x4_mul(a, b); }
+		inline FloatV div(FloatV a, FloatV b) { return wasm_f32x4_div(a, b); }
+		inline FloatV sqrtV(FloatV v) { return wasm_f32x4_sqrt(v); }
+		inline FloatV maxV(FloatV a, FloatV b) { return wasm_f32x4_max(a, b); }
+
+		inline FloatV exponentOf(FloatV v)
+		{
+			return wasm_f32x4_convert_i32x4(wasm_i32x4_sub(wasm_u32x4_shr(v, 23), wasm_i32x4_splat(127)));
+		}
+
+		inline FloatV mantissaOf(FloatV v)
+		{
+			return wasm_v128_or(wasm_v128_and(v, wasm_i32x4_splat(0x007fffff)), wasm_i32x4_splat(0x3f800000));
+		}
+#else
+		using FloatV = float;
+		constexpr u64 float_width = 1;
+
+		inline FloatV loadV(const float* p) { return *p; }
+		inline void storeV(float* p, FloatV v) { *p = v; }
+		inline FloatV splat(float v) { return v; }
+		inline FloatV add(FloatV a, FloatV b) { return a + b; }
+		inline FloatV sub(FloatV a, FloatV b) { return a - b; }
+		inline FloatV mul(FloatV a, FloatV b) { return a * b; }
+		inline FloatV div(FloatV a, FloatV b) { return a / b; }
+		inline FloatV sqrtV(FloatV v) { return std::sqrt(v); }
+		inline FloatV maxV(FloatV a, FloatV b) { return std::max(a, b); }
+
+		inline FloatV exponentOf(FloatV v)
+		{
+			u32 bits;
+			std::memcpy(&bits, &v, sizeof(bits));
+			return static_cast<float>(static_cast<i32>(bits >> 23) - 127);
+		}
+
+		inline FloatV mantissaOf(FloatV v)
+		{
+			u32 bits;
+			std::memcpy(&bits, &v, sizeof(bits));
+			bits = (bits & 0x007fffffu) | 0x3f800000u;
+			float mantissa;
+			std::memcpy(&mantissa, &bits, sizeof(mantissa));
+			return mantissa;
+		}
+#endif
+
+		// Natural logarithm of positive normal floats, absolute error below 2e-7.
+		// ln(m) = 2 atanh(s) with s = (m - 1) / (m + 1) in [0, 1/3) for the mantissa m
+		inline FloatV logV(FloatV v)
+		{
+			const FloatV m = mantissaOf(v);
+			const FloatV s = div(sub(m, splat(1.0f)), add(m, splat(1.0f)));
+			const FloatV s2 = mul(s, s);
+			FloatV p = splat(1.0f / 11.0f);
+			p = add(mul(p, s2), splat(1.0f / 9.0f));
+			p = add(mul(p, s2), splat(1.0f / 7.0f));
+			p = add(mul(p, s2), splat(1.0f / 5.0f));
+			p = add(mul(p, s2), splat(1.0f / 3.0f));
+			p = add(mul(p, s2), splat(1.0f));
+			return add(mul(exponentOf(v), splat(0.6931471805599453f)), mul(mul(splat(2.0f), s), p));
+		}
+
+		// Sine and cosine of 2 pi (u - 1/2) for u in [0, 1), absolute error below 3e-7.
+		// Taylor polynomials of the half angle in [-pi/2, pi/2) need no range reduction
+		inline void sinCos2PiV(FloatV u, FloatV& sine, FloatV& cosine)
+		{
+			const FloatV x = mul(sub(u, splat(0.5f)), splat(3.14159265358979f));
+			const FloatV x2 = mul(x, x);
+
+			FloatV sin_half = splat(-1.0f / 39916800.0f);
+			sin_half = add(mul(sin_half, x2), splat(1.0f / 362880.0f));
+			sin_half = add(mul(sin_half, x2), splat(-1.0f / 5040.0f));
+			sin_half = add(mul(sin_half, x2), splat(1.0f / 120.0f));
+			sin_half = add(mul(sin_half, x2), splat(-1.0f / 6.0f));
+			sin_half = mul(add(mul(sin_half, x2), splat(1.0f)), x);
+
+			FloatV cos_half = splat(1.0f / 479001600.0f);
+			cos_half = add(mul(cos_half, x2), splat(-1.0f / 3628800.0f));
+			cos_half = add(mul(cos_half, x2), splat(1.0f / 40320.0f));
+			cos_half = add(mul(cos_half, x2), splat(-1.0f / 720.0f));
+			cos_half = add(mul(cos_half, x2), splat(1.0f / 24.0f));
+			cos_half = add(mul(cos_half, x2), splat(-1.0f / 2.0f));
+			cos_half = add(mul(cos_half, x2), splat(1.0f));
+
+			sine = mul(splat(2.0f), mul(sin_half, cos_half));
+			cosine = sub(splat(1.0f), mul(splat(2.0f), mul(sin_half, sin_half)));
+		}
+
+		// Uniform values in [0, 1) come in chunks small enough to stay in L1. A chunk is rounded up
+		// to whole vectors in both of its halves, transforms read the first uniform of a sample from
+		// the first half and the second one from the same position of the second half
+		constexpr u64 chunk_size = 512;
+		static_assert(chunk_size % (2 * float_width) == 0);
+
+		template <class Func>
+		void forEachUniformChunk(u64 seed, u64 count, Func&& func)
+		{
+			alignas(32) float chunk[chunk_size];
+			BatchState state(seed);
+
+			for (u64 first = 0; first < count; first += chunk_size)
+			{
+				const u64 size = std::min(chunk_size, count - first);
+				const u64 padded = (size + 2 * float_width - 1) & ~(2 * float_width - 1);
+				fillValues(state, chunk, padded, 1.0f, -1.0f);
+				func(chunk, first, size, padded / 2);
+			}
+		}
+
 	}
 
-	i32 Random::next(i32 maxValue)
+	void random_batch::fillUniform(u64 seed, float* values, u64 count, float min_value, float max_value)
 	{
-		return next(0, maxValue);
+		BatchState state(seed);
+		const float scale = max_value - min_value;
+		fillValues(state, values, count, scale, min_value - scale);
 	}
 
-	i32 Random::next(i32 min_value, i32 max_value)
+	void random_batch::fillGaussian(u64 seed, float* values, u64 count, float mean, float standard_deviation)
 	{
-		std::uniform_int_distribution distribution(min_value, max_value);
-		return distribution(m_random_number_generator);
+		// Box-Muller, every pair of uniform values gives two normal ones which are written to both halves
+		forEachUniformChunk(seed, count, [&](float* chunk, u64 first, u64 size, u64 half)
+		{
+			const FloatV mean_v = splat(mean);
+			const FloatV deviation_v = splat(standard_deviation);
+			for (u64 n = 0; n < half; n += float_width)
+			{
+				// 1 - u is in (0, 1], so the logarithm is finite
+				const FloatV u = loadV(chunk + n);
+				const FloatV radius = mul(sqrtV(mul(splat(-2.0f), logV(sub(splat(1.0f), u)))), deviation_v);
+				FloatV sine, cosine;
+				sinCos2PiV(loadV(chunk + half + n), sine, cosine);
+				storeV(chunk + n, add(mean_v, mul(radius, cosine)));
+				storeV(chunk + half + n, add(mean_v, mul(radius, sine)));
+			}
+			std::copy_n(chunk, size, values + first);
+		});
 	}
 
-	float Random::nextFloat()
+	void random_batch::fillInUnitDisc(u64 seed, glm::vec2* points, u64 count)
 	{
-		return nextFloat(0.0f, 1.0f);
+		forEachUniformChunk(seed, count * 2, [&](float* chunk, u64 first, u64 size, u64 half)
+		{
+			for (u64 n = 0; n < half; n += float_width)
+			{
+				const FloatV radius = sqrtV(loadV(chunk + n));
+				FloatV sine, cosine;
+				sinCos2PiV(loadV(chunk + half + n), sine, cosine);
+				storeV(chunk + n, mul(radius, cosine));
+				storeV(chunk + half + n, mul(radius, sine));
+			}
+
+			glm::vec2* out = points + first / 2;
+			for (u64 n = 0; n < size / 2; ++n)
+				out[n] = { chunk[n], chunk[half + n] };
+		});
 	}
 
-	float Random::nextFloat(float min_value, float max_value)
+	void random_batch::fillOnUnitSphere(u64 seed, glm::vec3* points, u64 count)
 	{
-		std::uniform_real_distribution<> distribution(min_value, max_value);
-		return distribution(m_random_number_generator);
+		forEachUniformChunk(seed, count * 2, [&](float* chunk, u64 first, u64 size, u64 half)
+		{
+			alignas(32) float z[chunk_size / 2];
+			for (u64 n = 0; n < half; n += float_width)
+			{
+				const FloatV z_v = sub(mul(splat(2.0f), loadV(chunk + n)), splat(1.0f));
+				const FloatV radius = sqrtV(maxV(splat(0.0f), sub(splat(1.0f), mul(z_v, z_v))));
+				FloatV sine, cosine;
+				sinCos2PiV(loadV(chunk + half + n), sine, cosine);
+				storeV(z + n, z_v);
+				storeV(chunk + n, mul(radius, cosine));
+				storeV(chunk + half + n, mul(radius, sine));
+			}
+
+			glm::vec3* out = points + first / 2;
+			for (u64 n = 0; n < size / 2; ++n)
+				out[n] = { chunk[n], chunk[half + n], z[n] };
+		});
 	}
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,366 @@
+#include "uze/core/registry_snapshot.h"
+#include "uze/core/job_system.h"
+#include "uze/core/profiler.h"
+
+namespace uze
+{
+
+	static constexpr LogCategory log_snapshot { "Snapshot" };
+
+	static constexpr u32 snapshot_magic = 0x53455a55; // "UZES"
+	static constexpr u32 snapshot_version = 1;
+	static constexpr u32 delta_magic = 0x44455a55; // "UZED"
+	static constexpr u32 delta_version = 2;
+
+	// Reads size bytes in chunks, so a corrupted size can't allocate more than the stream actually has
+	template <class Container>
+	static bool readBlock(std::istream& i, u64 size, Container& data)
+	{
+		constexpr u64 chunk_size = 1 << 20;
+		data.clear();
+		while (data.size() < size)
+		{
+			const u64 offset = data.size();
+			const u64 count = std::min(chunk_size, size - offset);
+			data.resize(offset + count);
+			if (!i.read(reinterpret_cast<char*>(data.data() + offset), static_cast<std::streamsize>(count)))
+				return false;
+		}
+		return true;
+	}
+
+	void RegistrySnapshot::save(const entt::registry& registry, std::ostream& o) const
+	{
+		UZE_PROFILE_SCOPE("RegistrySnapshot::save");
+		std::vector<std::vector<u8>> blocks(m_pools.size());
+		job_system::parallelFor(m_pools.size(), [&](u64 index)
+		{
+			m_pools[index].save(registry, blocks[index]);
+		});
+
+		BinarySerializer<u32>{}(o, snapshot_magic);
+		BinarySerializer<u32>{}(o, snapshot_version);
+		BinarySerializer<u64>{}(o, m_pools.size());
+
+		for (u64 i = 0; i < m_pools.size(); ++i)
+		{
+			BinarySerializer<u64>{}(o, m_pools[i].id);
+			BinarySerializer<u64>{}(o, blocks[i].size());
+			o.write(reinterpret_cast<const char*>(blocks[i].data()), static_cast<std::streamsize>(blocks[i].size()));
+		}
+	}
+
+	bool RegistrySnapshot::load(entt::registry& registry, std::istream& i) const
+	{
+		UZE_PROFILE_SCOPE("RegistrySnapshot::load");
+		u32 magic = 0;
+		u32 version = 0;
+		u64 num_pools = 0;
+		BinaryDeserializer<u32>{}(i, magic);
+		BinaryDeserializer<u32>{}(i, version);
+		BinaryDeserializer<u64>{}(i, num_pools);
+
+		if (!i || magic != snapshot_magic || version != snapshot_version)
+		{
+			uzLog(log_snapshot, Error, "Cannot load registry snapshot: invalid header");
+			return false;
+		}
+
+		struct Block
+		{
+			const Pool* pool;
+			std::vector<u8> data;
+			std::vector<entt::entity> entities;
+			std::shared_ptr<void> components;
+		};
+
+		std::vector<Block> blocks;
+		blocks.reserve(num_pools);
+		for (u64 n = 0; n < num_pools; ++n)
+		{
+			u64 id = 0;
+			u64 size = 0;
+			BinaryDeserializer<u64>{}(i, id);
+			BinaryDeserializer<u64>{}(i, size);
+			if (!i)
+				break;
+
+			const Pool* pool = findPool(id);
+			if (!pool)
+			{
+				uzLog(log_snapshot, Warn, "Skipping unknown component pool {:#018x}", id);
+				i.seekg(static_cast<std::streamoff>(size), std::ios::cur);
+				continue;
+			}
+
+			Block block{ pool };
+			if (!readBlock(i, size, block.data))
+				break;
+
+			u64 count = 0;
+			if (size >= sizeof(u64))
+				std::memcpy(&count, block.data.data(), sizeof(u64));
+			if (size < sizeof(u64) || count > (size - sizeof(u64)) / sizeof(entt::entity))
+			{
+				uzLog(log_snapshot, Error, "Cannot load registry snapshot: corrupted component pool");
+				return false;
+			}
+
+			block.entities.resize(count);
+			if (count)
+				std::memcpy(block.entities.data(), block.data.data() + sizeof(u64), count * sizeof(entt::entity));
+
+			blocks.push_back(std::move(block));
+		}
+
+		if (!i)
+		{
+			uzLog(log_snapshot, Error, "Cannot load registry snapshot: unexpected end of stream");
+			return false;
+		}
+
+		// Every pool is decoded before anything in the registry changes
+		job_system::parallelFor(blocks.size(), [&](u64 index)
+		{
+			auto& block = blocks[index];
+			const u64 offset = sizeof(u64) + block.entities.size() * sizeof(entt::entity);
+			block.components = block.pool->decode(block.entities.size(), block.data.data() + offset,
+				block.data.size() - offset);
+		});
+
+		for (const auto& block : blocks)
+		{
+			if (!block.components)
+			{
+				uzLog(log_snapshot, Error, "Cannot load registry snapshot: corrupted component pool");
+				return false;
+			}
+		}
+
+		// Entities and pools are created serially, after that every pool is only touched by one job
+		registry.clear();
+		for (auto& block : blocks)
+		{
+			block.pool->prepare(registry);
+			for (const auto entity : block.entities)
+			{
+				if (!registry.valid(entity))
+					registry.create(entity);
+			}
+		}
+
+		job_system::parallelFor(blocks.size(), [&](u64 index)
+		{
+			auto& block = blocks[index];
+			block.pool->insert(registry, block.entities.data(), block.entities.size(), block.components.get());
+		});
+
+		return true;
+	}
+
+	void RegistrySnapshot::track(entt::registry& registry, RegistryBaseline& baseline) const
+	{
+		baseline.stopTracking();
+		baseline.m_registry = &registry;
+		for (const auto& pool : m_pools)
+		{
+			auto& state = *baseline.m_pools.emplace_back(std::make_unique<RegistryBaseline::PoolState>());
+			pool.track(registry, state, baseline.m_connections);
+		}
+	}
+
+	void RegistrySnapshot::saveDelta(const entt::registry& registry, RegistryBaseline& baseline, std::ostream& o) const
+	{
+		UZE_PROFILE_SCOPE("RegistrySnapshot::saveDelta");
+		const bool tracked = baseline.m_registry == &registry && baseline.m_pools.size() == m_pools.size();
+		const bool full = !tracked || baseline.m_full;
+
+		// Dirty entities are taken from the baseline, which starts recording the next delta
+		std::vector<std::vector<entt::entity>> entities(m_pools.size());
+		if (tracked)
+		{
+			for (u64 i = 0; i < m_pools.size(); ++i)
+			{
+				entities[i].swap(baseline.m_pools[i]->dirty);
+			}
+			baseline.m_full = false;
+		}
+
+		std::vector<std::string> blocks(m_pools.size());
+		job_system::parallelFor(m_pools.size(), [&](u64 index)
+		{
+			blocks[index] = m_pools[index].saveChanges(registry, entities[index], full);
+		});
+
+		// A dirty entity which isn't valid anymore was destroyed, possibly with its index recycled.
+		// A full delta is applied on top of an unknown state, so it doesn't destroy anything
+		std::vector<entt::entity> destroyed;
+		if (!full)
+		{
+			for (const auto& pool_entities : entities)
+			{
+				for (const auto entity : pool_entities)
+				{
+					if (!registry.valid(entity))
+						destroyed.push_back(entity);
+				}
+			}
+			std::sort(destroyed.begin(), destroyed.end());
+			destroyed.erase(std::unique(destroyed.begin(), destroyed.end()), destroyed.end());
+		}
+
+		u64 num_changed_pools = 0;
+		for (const auto& block : blocks)
+		{
+			num_changed_pools += !block.empty();
+		}
+
+		BinarySerializer<u32>{}(o, delta_magic);
+		BinarySerializer<u32>{}(o, delta_version);
+		compact::writeDeltaArray(o, destroyed);
+		compact::writeVarint(o, num_changed_pools);
+
+		for (u64 i = 0; i < m_pools.size(); ++i)
+		{
+			if (blocks[i].empty())
+				continue;
+
+			BinarySerializer<u64>{}(o, m_pools[i].id);
+			compact::writeVarint(o, blocks[i].size());
+			o.write(blocks[i].data(), static_cast<std::streamsize>(blocks[i].size()));
+		}
+	}
+
+	bool RegistrySnapshot::loadDelta(entt::registry& registry, std::istream& i) const
+	{
+		UZE_PROFILE_SCOPE("RegistrySnapshot::loadDelta");
+		u32 magic = 0;
+		u32 version = 0;
+		BinaryDeserializer<u32>{}(i, magic);
+		BinaryDeserializer<u32>{}(i, version);
+		if (!i || magic != delta_magic || version != delta_version)
+		{
+			uzLog(log_snapshot, Error, "Cannot load registry delta: invalid header");
+			return false;
+		}
+
+		std::vector<entt::entity> destroyed;
+		compact::readDeltaArray(i, destroyed);
+		const u64 num_pools = compact::readVarint(i);
+		if (!i)
+		{
+			uzLog(log_snapshot, Error, "Cannot load registry delta: invalid header");
+			return false;
+		}
+
+		struct Block
+		{
+			const Pool* pool;
+			std::vector<entt::entity> removed;
+			std::vector<entt::entity> changed;
+			std::string data;
+			u64 payload_offset{ 0 };
+			bool loaded{ false };
+		};
+
+		std::vector<Block> blocks;
+		blocks.reserve(num_pools);
+		for (u64 n = 0; n < num_pools; ++n)
+		{
+			u64 id = 0;
+			BinaryDeserializer<u64>{}(i, id);
+			const u64 size = compact::readVarint(i);
+			if (!i)
+				break;
+
+			const Pool* pool = findPool(id);
+			if (!pool)
+			{
+				uzLog(log_snapshot, Warn, "Skipping unknown component pool {:#018x}", id);
+				i.seekg(static_cast<std::streamoff>(size), std::ios::cur);
+				continue;
+			}
+
+			Block block{ pool };
+			if (!readBlock(i, size, block.data))
+				break;
+
+			MemoryInputStream in(block.data.data(), size);
+			compact::readDeltaArray(in, block.removed);
+			compact::readDeltaArray(in, block.changed);
+			if (!in)
+			{
+				uzLog(log_snapshot, Error, "Cannot load registry delta: corrupted component pool");
+				return false;
+			}
+
+			block.payload_offset = static_cast<u64>(in.tellg());
+			blocks.push_back(std::move(block));
+		}
+
+		if (!i)
+		{
+			uzLog(log_snapshot, Error, "Cannot load registry delta: unexpected end of stream");
+			return false;
+		}
+
+		for (const auto entity : destroyed)
+		{
+			if (registry.valid(entity))
+				registry.destroy(entity);
+		}
+
+		using traits = entt::entt_traits<entt::entity>;
+		for (const auto& block : blocks)
+		{
+			block.pool->prepare(registry);
+			for (const auto entity : block.changed)
+			{
+				if (registry.valid(entity))
+					continue;
+
+				// Another version at the same index would make create ignore the hint
+				const auto stale = traits::construct(entt::to_entity(entity), registry.current(entity));
+				if (registry.valid(stale))
+					registry.destroy(stale);
+
+				if (registry.create(entity) != entity)
+				{
+					uzLog(log_snapshot, Error, "Cannot load registry delta: cannot recreate entity {}",
+						static_cast<u64>(entt::to_integral(entity)));
+					return false;
+				}
+			}
+		}
+
+		job_system::parallelFor(blocks.size(), [&](u64 index)
+		{
+			auto& block = blocks[index];
+			block.loaded = block.pool->applyDelta(registry, block.removed, block.changed,
+				reinterpret_cast<const u8*>(block.data.data()) + block.payload_offset,
+				block.data.size() - block.payload_offset);
+		});
+
+		bool success = true;
+		for (const auto& block : blocks)
+		{
+			success &= block.loaded;
+		}
+
+		if (!success)
+			uzLog(log_snapshot, Error, "Some of component pools in registry delta are corrupted");
+
+		return success;
+	}
+
+	const RegistrySnapshot::Pool* RegistrySnapshot::findPool(u64 id) const
+	{
+		for (const auto& pool : m_pools)
+		{
+			if (pool.id == id)
+				return &pool;
+		}
+		return nullptr;
+	}
+
+}
@@ -1,4 +1,5 @@
 #include "uze/core/type_info.h"
+#include <algorithm>
 #include <vector>
 
 namespace uze
@@ -17,68 +18,311 @@ namespace uze
 	}
 
 	Registry s_registry;
+	// Both are constant-initialized, registrars of other translation units may run before this one is initialized
 	bool s_initialized{ false };
-	std::vector<std::function<void()>> s_register_queue;
+	TypeRegistration* s_pending{ nullptr };
 
 	constexpr static LogCategory log_registry { "Registry" };
 
-	const TypeInfo& Object::getTypeInfo() const
+	const TypeInfo& Object::getStaticTypeInfo()
 	{
-		static TypeInfo* ti = Registry::getTypeInfo(refl::reflect<Object>().name.c_str());
+		static const TypeInfo* ti = Registry::getTypeInfo<Object>();
 		return *ti;
 	}
 
+	const TypeInfo& Object::getTypeInfo() const
+	{
+		return getStaticTypeInfo();
+	}
+
 	void Registry::init()
 	{
 		if (s_initialized) return;
 
-		for (auto& func : getRegisterQueue())
-		{
-			func();
-		}
-
+		Stopwatch stopwatch;
+		get().freeze();
 		s_initialized = true;
+
+		uzLog(log_registry, Info, "Registered {} types in {:.2f} ms", getNumTypes(), stopwatch.getElapsedMilliseconds());
 	}
 
-	TypeInfo* Registry::getTypeInfo(std::string_view name)
+	const TypeInfo* Registry::getTypeInfo(TypeId id)
 	{
-		auto it = get().m_types.find(name.data());
-		if (it == get().m_types.end())
-			return nullptr;
+		auto slot = get().findTypeIndex(id);
+		return slot ? get().m_types[slot->index] : nullptr;
+	}
 
-		return it->second.get();
+	const TypeInfo* Registry::getTypeInfoByIndex(u32 index)
+	{
+		return index < get().m_types.size() ? get().m_types[index] : nullptr;
 	}
 
-	void Registry::addType(TypeInfo* ti)
+	u32 Registry::getNumTypes()
 	{
-		std::string name = ti->name;
-		get().m_types.emplace(name, std::shared_ptr<TypeInfo>(ti));
-		uzLog(log_registry, Info, fmt::format("Registered type `{}`", name));
+		return static_cast<u32>(get().m_types.size());
 	}
 
-	void Registry::registerImpl(const std::function<void()>& func)
+	void Registry::freeze()
 	{
-		if (!s_initialized)
+		std::vector<TypeRegistration*> pending;
+		for (auto registration = s_pending; registration; registration = registration->next)
 		{
-			getRegisterQueue().push_back(func);
+			pending.push_back(registration);
+		}
+		s_pending = nullptr;
+
+		if (pending.empty())
 			return;
+
+		// The list is linked in reverse
+		std::reverse(pending.begin(), pending.end());
+
+		// Sorted by id to find pending parents without building a map
+		std::vector<TypeRegistration*> pending_ids = pending;
+		std::stable_sort(pending_ids.begin(), pending_ids.end(), [](const TypeRegistration* a, const TypeRegistration* b)
+		{
+			return a->id < b->id;
+		});
+
+		for (u64 n = 0; n < pending_ids.size(); ++n)
+		{
+			auto& registration = *pending_ids[n];
+			if (findTypeIndex(registration.id) || (n && pending_ids[n - 1]->id == registration.id))
+			{
+				uzLog(log_registry, Warn, "Type `{}` is already registered or its id collides with another type", registration.name);
+				registration.visited = true;
+			}
+		}
+
+		const auto findPending = [&](TypeId id) -> TypeRegistration*
+		{
+			auto it = std::lower_bound(pending_ids.begin(), pending_ids.end(), id, [](const TypeRegistration* r, TypeId id)
+			{
+				return r->id < id;
+			});
+			return it != pending_ids.end() && (*it)->id == id ? *it : nullptr;
+		};
+
+		// Parents are ordered before their children, so a type may be registered before its parents,
+		// parents always have lower indices and ancestor tables are built in a single pass
+		std::vector<TypeRegistration*> accepted;
+		accepted.reserve(pending.size());
+		const auto visit = [&](auto& self, TypeRegistration& registration) -> void
+		{
+			if (registration.visited)
+				return;
+
+			registration.visited = true;
+			for (u32 n = 0; n < registration.num_parents; ++n)
+			{
+				if (auto parent = findPending(registration.parents[n].id))
+					self(self, *parent);
+			}
+			accepted.push_back(&registration);
+		};
+
+		for (auto registration : pending)
+		{
+			visit(visit, *registration);
+		}
+
+		const auto first_index = static_cast<u32>(m_types.size());
+		if ((m_types.size() + accepted.size()) * 2 > m_type_indices.size())
+		{
+			u64 capacity = 64;
+			while (capacity < (m_types.size() + accepted.size()) * 2)
+				capacity *= 2;
+
+			m_type_indices.assign(capacity, {});
+			for (const auto ti : m_types)
+			{
+				insertTypeIndex(ti->id, ti->index);
+			}
+		}
+
+		u64 num_members = 0;
+		u64 num_parents = 0;
+		for (u64 n = 0; n < accepted.size(); ++n)
+		{
+			insertTypeIndex(accepted[n]->id, static_cast<u32>(first_index + n));
+			num_members += accepted[n]->num_members;
+			num_parents += accepted[n]->num_parents;
+		}
+
+		auto arena = std::make_unique<Arena>();
+		arena->types.resize(accepted.size());
+		arena->members.resize(num_members);
+		arena->parents.reserve(num_parents);
+
+		u64 names_size = 0;
+		for (u64 n = 0, first_member = 0; n < accepted.size(); ++n)
+		{
+			const auto& registration = *accepted[n];
+			registration.write_members(arena->members.data() + first_member);
+			arena->types[n].members = { arena->members.data() + first_member, registration.num_members };
+			first_member += registration.num_members;
+
+			names_size += registration.name.size();
+			for (const auto& member : arena->types[n].members)
+			{
+				names_size += member.name.size();
+			}
 		}
 
-		func();
+		// Reserved up front, copied names stay valid while the arena is filled
+		arena->names.reserve(names_size);
+		const auto copyName = [&](std::string_view str)
+		{
+			const auto position = arena->names.size();
+			arena->names.append(str);
+			return std::string_view(arena->names.data() + position, str.size());
+		};
+
+		for (u64 n = 0; n < accepted.size(); ++n)
+		{
+			m_types.push_back(&arena->types[n]);
+		}
+
+		// Ancestors of a type are its primary chain followed by secondary ancestors,
+		// views are set once the array is filled
+		struct AncestorRange
+		{
+			u64 first;
+			u32 num_primary;
+			u32 num_secondary;
+		};
+
+		std::vector<AncestorRange> ancestor_ranges(accepted.size());
+		std::vector<u32> primary;
+		std::vector<u32> secondary;
+		const auto appendAncestors = [&](const TypeInfo& ti, bool primary_chain, std::vector<u32>& out)
+		{
+			if (ti.index < first_index)
+			{
+				const auto ancestors = primary_chain ? ti.primary_ancestors : ti.secondary_ancestors;
+				out.insert(out.end(), ancestors.begin(), ancestors.end());
+				return;
+			}
+
+			const auto& range = ancestor_ranges[ti.index - first_index];
+			const auto first = arena->ancestors.begin() + range.first + (primary_chain ? 0 : range.num_primary);
+			out.insert(out.end(), first, first + (primary_chain ? range.num_primary : range.num_secondary));
+		};
+
+		for (u64 n = 0; n < accepted.size(); ++n)
+		{
+			const auto& registration = *accepted[n];
+			auto& ti = arena->types[n];
+			ti.name = copyName(registration.name);
+			ti.id = registration.id;
+			ti.index = static_cast<u32>(first_index + n);
+			ti.size = registration.size;
+			ti.alignment = registration.alignment;
+			ti.trivially_copyable = registration.trivially_copyable;
+
+			auto members = arena->members.data() + (ti.members.begin() - arena->members.data());
+			for (u32 m = 0; m < ti.members.size(); ++m)
+			{
+				members[m].name = copyName(members[m].name);
+			}
+
+			const auto first_parent = arena->parents.size();
+			for (u32 p = 0; p < registration.num_parents; ++p)
+			{
+				const auto& parent = registration.parents[p];
+				auto slot = findTypeIndex(parent.id);
+				if (!slot)
+				{
+					uzLog(log_registry, Warn, "Type `{}` inherits from `{}`, but it isn't registered", registration.name, parent.name);
+					continue;
+				}
+
+				arena->parents.push_back(m_types[slot->index]);
+			}
+			ti.parents = { arena->parents.data() + first_parent, static_cast<u32>(arena->parents.size() - first_parent) };
+
+			// Indices on the first-parent chain grow with depth, so the chain is sorted
+			primary.clear();
+			secondary.clear();
+			if (!ti.parents.empty())
+			{
+				appendAncestors(*ti.parents[0], true, primary);
+
+				for (const auto parent : ti.parents)
+				{
+					appendAncestors(*parent, false, secondary);
+					if (parent != ti.parents[0])
+						appendAncestors(*parent, true, secondary);
+				}
+
+				std::sort(secondary.begin(), secondary.end());
+				secondary.erase(std::unique(secondary.begin(), secondary.end()), secondary.end());
+				secondary.erase(std::remove_if(secondary.begin(), secondary.end(), [&](u32 index)
+				{
+					return std::binary_search(primary.begin(), primary.end(), index);
+				}), secondary.end());
+			}
+
+			primary.push_back(ti.index);
+			ti.depth = static_cast<u32>(primary.size() - 1);
+
+			ancestor_ranges[n] = { arena->ancestors.size(), static_cast<u32>(primary.size()), static_cast<u32>(secondary.size()) };
+			arena->ancestors.insert(arena->ancestors.end(), primary.begin(), primary.end());
+			arena->ancestors.insert(arena->ancestors.end(), secondary.begin(), secondary.end());
+		}
+
+		for (u64 n = 0; n < accepted.size(); ++n)
+		{
+			const auto& range = ancestor_ranges[n];
+			auto& ti = arena->types[n];
+			ti.primary_ancestors = { arena->ancestors.data() + range.first, range.num_primary };
+			ti.secondary_ancestors = { ti.primary_ancestors.end(), range.num_secondary };
+		}
+
+		m_arenas.push_back(std::move(arena));
 	}
 
-	Registry& Registry::get()
+	const Registry::TypeIndexSlot* Registry::findTypeIndex(TypeId id) const
 	{
-		return s_registry;
+		if (m_type_indices.empty() || id == 0)
+			return nullptr;
+
+		const u64 mask = m_type_indices.size() - 1;
+		for (u64 n = id & mask;; n = (n + 1) & mask)
+		{
+			const auto& slot = m_type_indices[n];
+			if (slot.id == id)
+				return &slot;
+			if (slot.id == 0)
+				return nullptr;
+		}
+	}
+
+	void Registry::insertTypeIndex(TypeId id, u32 index)
+	{
+		const u64 mask = m_type_indices.size() - 1;
+		u64 n = id & mask;
+		while (m_type_indices[n].id != 0)
+			n = (n + 1) & mask;
+
+		m_type_indices[n] = { id, index };
 	}
 
-	std::vector<std::function<void()>>& Registry::getRegisterQueue()
+	void Registry::registerImpl(TypeRegistration& registration)
 	{
-		return s_register_queue;
+		if (registration.linked)
+			return;
+
+		registration.linked = true;
+		registration.next = s_pending;
+		s_pending = &registration;
+
+		if (s_initialized)
+			get().freeze();
 	}
 
-	void Registry::logWarn(std::string_view str)
+	Registry& Registry::get()
 	{
-		uzLog(log_registry, Warn, str);
+		return s_registry;
 	}
 }
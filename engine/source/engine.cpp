@@ -5,10 +5,11 @@
 #include "uze/core/type_info.h"
 #include "uze/core/job_system.h"
 #include "uze/core/random.h"
+#include "uze/core/profiler.h"
+#include "uze/core/registry_snapshot.h"
 #include "renderer/opengl.h"
 #include <SDL3/SDL.h>
 #include <entt/entt.hpp>
-#include <iostream>
 #include <fstream>
 
 #include "glm/ext/matrix_transform.hpp"
@@ -68,8 +69,27 @@ namespace uze
 		float speed{ 3.0f };
 	};
 
+}
+
+REFL_AUTO(type(uze::TransformComponent), field(position), field(rotation))
+REFL_AUTO(type(uze::SpriteRendererComponent), field(color), field(z_layer))
+REFL_AUTO(type(uze::PlayerComponent), field(speed))
+
+namespace uze
+{
+
+	static RegistrySnapshot s_snapshot;
+	static constexpr std::string_view snapshot_file = "world.bin";
+	static constexpr std::string_view trace_file = "trace.json";
+	static constexpr std::string_view frame_stats_file = "frame_stats.csv";
+	static constexpr u64 status_interval_ms = 250;
+	static u64 s_last_status_ticks = 0;
+
 	void EntryPoint()
 	{
+		startAsyncLogging();
+		profiler::setThreadName("Main");
+
 		renderer = std::make_unique<Renderer>();
 		if (!renderer->isValid())
 		{
@@ -94,6 +114,10 @@ namespace uze
 		//Registry::registerType<Entity>();
 		job_system::init();
 
+		s_snapshot.component<TransformComponent>()
+			.component<SpriteRendererComponent>()
+			.component<PlayerComponent>();
+
 		{
 			EntityTest et;
 			et.name = "Entity Test";
@@ -108,14 +132,14 @@ namespace uze
 
 			std::ofstream out("input.txt", std::ios::binary);
 
-			BinarySerializer<decltype(et)>{}(out, et);
+			TaggedBinarySerializer<decltype(et)>{}(out, et);
 			uzLog(log_engine, Debug, "Serialized EntityTest to input.txt");
 		}
 
 		{
 			EntityTest et2;
 			std::ifstream in("input.txt", std::ios::binary);
-			BinaryDeserializer<decltype(et2)>{}(in, et2);
+			TaggedBinaryDeserializer<decltype(et2)>{}(in, et2);
 		}
 
 		Random random;
@@ -140,7 +164,7 @@ namespace uze
 		}
 
 #if !defined(__EMSCRIPTEN__)
-		std::cout << "Frame time: 0ms";
+		writeLogOutput("Frame time: 0ms");
 #endif
 
 #if !defined(__EMSCRIPTEN__)
@@ -148,6 +172,8 @@ namespace uze
 		{
 			gameLoop();
 		}
+
+		stopAsyncLogging();
 #else
 		emscripten_set_main_loop(gameLoop, -1, 1);
 #endif
@@ -160,6 +186,8 @@ namespace uze
 
 	static void gameLoop()
 	{
+		UZE_PROFILE_SCOPE("Frame");
+
 		SDL_Event e;
 		while (SDL_PollEvent(&e) != 0)
 		{
@@ -173,6 +201,43 @@ namespace uze
 			else if (e.type == SDL_EVENT_KEY_DOWN)
 			{
 				s_press_states[e.key.keysym.sym] = true;
+
+				if (e.key.keysym.sym == SDLK_F5)
+				{
+					std::ofstream out(snapshot_file.data(), std::ios::binary);
+					s_snapshot.save(registry, out);
+					uzLog(log_engine, Info, "Saved world to `{}`", snapshot_file);
+				}
+				else if (e.key.keysym.sym == SDLK_F9)
+				{
+					if (std::ifstream in(snapshot_file.data(), std::ios::binary); in.is_open()
+						&& s_snapshot.load(registry, in))
+						uzLog(log_engine, Info, "Loaded world from `{}`", snapshot_file);
+				}
+				else if (e.key.keysym.sym == SDLK_F4)
+				{
+					const auto& frame_stats = renderer->getFrameStatistics();
+					const auto summary = frame_stats.getSummary();
+					uzLog(log_engine, Info, "Last {} frames: min {:.2f}ms, avg {:.2f}ms, p50 {:.2f}ms, p95 {:.2f}ms, "
+						"p99 {:.2f}ms, max {:.2f}ms, {} hitches", summary.num_frames, summary.min_ms, summary.average_ms,
+						summary.p50_ms, summary.p95_ms, summary.p99_ms, summary.max_ms, summary.num_hitches);
+
+					std::ofstream out(frame_stats_file.data());
+					if (frame_stats.writeCsv(out))
+						uzLog(log_engine, Info, "Saved frame statistics to `{}`", frame_stats_file);
+				}
+				else if (e.key.keysym.sym == SDLK_F3)
+				{
+					if (!profiler::isCapturing())
+						profiler::startCapture();
+					else
+					{
+						profiler::stopCapture();
+						std::ofstream out(trace_file.data(), std::ios::binary);
+						if (profiler::writeChromeTrace(out))
+							uzLog(log_engine, Info, "Saved profiler trace to `{}`", trace_file);
+					}
+				}
 			}
 			else if (e.type == SDL_EVENT_KEY_UP)
 			{
@@ -180,24 +245,27 @@ namespace uze
 			}
 		}
 
-		registry.view<TransformComponent, PlayerComponent>().each(
-		[](auto& transform, auto& player)
-			{
-				glm::vec2 direction{ 0.0f, 0.0f };
-				if (s_press_states[SDLK_w])
-					direction.y += 1.0f;
-				if (s_press_states[SDLK_s])
-					direction.y -= 1.0f;
-				if (s_press_states[SDLK_a])
-					direction.x -= 1.0f;
-				if (s_press_states[SDLK_d])
-					direction.x += 1.0f;
-
-				transform.position += direction * player.speed
-					* static_cast<float>(sw.getElapsedSeconds());
-			});
-
-		sw.reset();
+		{
+			UZE_PROFILE_SCOPE("Update");
+			registry.view<TransformComponent, PlayerComponent>().each(
+			[](auto& transform, auto& player)
+				{
+					glm::vec2 direction{ 0.0f, 0.0f };
+					if (s_press_states[SDLK_w])
+						direction.y += 1.0f;
+					if (s_press_states[SDLK_s])
+						direction.y -= 1.0f;
+					if (s_press_states[SDLK_a])
+						direction.x -= 1.0f;
+					if (s_press_states[SDLK_d])
+						direction.x += 1.0f;
+
+					transform.position += direction * player.speed
+						* static_cast<float>(sw.getElapsedSeconds());
+				});
+
+			sw.reset();
+		}
 
 		renderer->beginFrame();
 		renderer->clear(0.5f, 1.f, 0.2f, 1.f);
@@ -205,44 +273,57 @@ namespace uze
 		static std::vector<entt::entity> entities_to_draw;
 		entities_to_draw.clear();
 
-		registry.view<TransformComponent, SpriteRendererComponent>().each(
-			[](entt::entity e, auto& tc, auto& sprite)
-			{
-				for (u64 i = 0; i < entities_to_draw.size(); ++i)
+		{
+			UZE_PROFILE_SCOPE("Sort sprites");
+			registry.view<TransformComponent, SpriteRendererComponent>().each(
+				[](entt::entity e, auto& tc, auto& sprite)
 				{
-					if (registry.get<SpriteRendererComponent>(entities_to_draw[i]).z_layer
-						< sprite.z_layer)
+					for (u64 i = 0; i < entities_to_draw.size(); ++i)
 					{
-						entities_to_draw.insert(entities_to_draw.begin() + i, e);
-						return;
+						if (registry.get<SpriteRendererComponent>(entities_to_draw[i]).z_layer
+							< sprite.z_layer)
+						{
+							entities_to_draw.insert(entities_to_draw.begin() + i, e);
+							return;
+						}
 					}
-				}
 
-				entities_to_draw.push_back(e);
-				
-			});
+					entities_to_draw.push_back(e);
+					
+				});
+		}
 
-		for (auto it = entities_to_draw.rbegin(); it != entities_to_draw.rend(); ++it)
 		{
-			auto e = *it;
-			const auto& tc = registry.get<TransformComponent>(e);
-			const auto& sprite = registry.get<SpriteRendererComponent>(e);
+			UZE_PROFILE_SCOPE("Draw sprites");
+			for (auto it = entities_to_draw.rbegin(); it != entities_to_draw.rend(); ++it)
+			{
+				auto e = *it;
+				const auto& tc = registry.get<TransformComponent>(e);
+				const auto& sprite = registry.get<SpriteRendererComponent>(e);
 
-			renderer->drawQuad(tc.position, sprite.color);
+				renderer->drawQuad(tc.position, sprite.color);
+			}
 		}
 
 		renderer->endFrame();
 
+		if (profiler::isCapturing())
+			profiler::collect();
+
+		// A few times per second, a status line per frame only keeps the console busy
+		const u64 ticks = SDL_GetTicks();
+		if (ticks - s_last_status_ticks >= status_interval_ms)
+		{
+			s_last_status_ticks = ticks;
+			const auto& stats = renderer->getStatistics();
 #if UZE_PLATFORM != UZE_PLATFORM_WEB
-		std::cout << "\r                                                                                       \r";
-#endif
-		std::cout << "Frame time: " << renderer->getStatistics().frame_time_ms
-			<< "ms; draw calls: " << renderer->getStatistics().num_draw_calls
-			<< "; num quads: " << renderer->getStatistics().num_quads << "; PCIe: "
-			<< renderer->getStatistics().data_transmitted << " bytes";
-#if UZE_PLATFORM == UZE_PLATFORM_WEB
-		std::cout << "\n";
+			writeLogOutput(fmt::format("\r{:87}\rFrame time: {}ms; draw calls: {}; num quads: {}; PCIe: {} bytes",
+				"", stats.frame_time_ms, stats.num_draw_calls, stats.num_quads, stats.data_transmitted));
+#else
+			writeLogOutput(fmt::format("Frame time: {}ms; draw calls: {}; num quads: {}; PCIe: {} bytes\n",
+				stats.frame_time_ms, stats.num_draw_calls, stats.num_quads, stats.data_transmitted));
 #endif
+		}
 	}
 	
 }
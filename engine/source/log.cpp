@@ -1,58 +1,1293 @@
 #include "uze/log.h"
+#include "uze/log_sink.h"
+#include "core/diagnostics.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <filesystem>
 #include <iostream>
+#include <iterator>
 #include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <fmt/args.h>
+
+#if UZE_PLATFORM != UZE_PLATFORM_WEB
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <thread>
+#endif
 
 namespace uze
 {
 
+	using diagnostics::appendJsonString;
+	using diagnostics::getThreadIndex;
+
 	static std::ostream* out_stream = &std::cout;
 	static std::mutex s_mutex;
+	// Guarded by s_mutex
+	static std::vector<std::shared_ptr<LogSink>> s_sinks;
+
+	std::atomic<u8> uzLog_levels[log_level_slots]{};
+	static std::mutex s_levels_mutex;
+	static LogLevel s_default_level{ LL_Debug };
+	static bool s_level_overridden[log_level_slots]{};
 
 	void initLogging(std::ostream& out)
 	{
+		std::scoped_lock lock(s_mutex);
 		std::ostream::sync_with_stdio(false);
 		out_stream = &out;
 	}
 
-	static const std::string_view log_format_str = "[{}] {}";
+	void addLogSink(std::shared_ptr<LogSink> sink)
+	{
+		std::scoped_lock lock(s_mutex);
+		s_sinks.push_back(std::move(sink));
+	}
 
-	void uzLog_ImplDebug(std::string_view log, std::string_view file, u64 line)
+	void removeLogSink(const std::shared_ptr<LogSink>& sink)
 	{
 		std::scoped_lock lock(s_mutex);
-		getOutputStream() << fmt::format(log_format_str, "DEBUG", fmt::format("`{}`, line {}", file, line)) << "\n";
-		getOutputStream() << fmt::format(log_format_str, "DEBUG", log) << "\n";
+		s_sinks.erase(std::remove(s_sinks.begin(), s_sinks.end(), sink), s_sinks.end());
+	}
+
+	// Called with s_mutex locked
+	static void writeText(std::string_view text, bool flush)
+	{
+		getOutputStream().write(text.data(), static_cast<std::streamsize>(text.size()));
+		if (flush)
+			getOutputStream().flush();
+
+		for (const auto& sink : s_sinks)
+		{
+			sink->write(text);
+			if (flush)
+				sink->flush();
+		}
+	}
+
+	static u32 getLevelSlot(std::string_view category)
+	{
+		return fnv1a32(category) & (log_level_slots - 1);
+	}
+
+	void setLogLevel(LogLevel level)
+	{
+		std::scoped_lock lock(s_levels_mutex);
+		s_default_level = level;
+		for (u32 n = 0; n < log_level_slots; ++n)
+		{
+			if (!s_level_overridden[n])
+				uzLog_levels[n].store(static_cast<u8>(level), std::memory_order_relaxed);
+		}
+	}
+
+	void setLogLevel(std::string_view category, LogLevel level)
+	{
+		std::scoped_lock lock(s_levels_mutex);
+		const auto slot = getLevelSlot(category);
+		s_level_overridden[slot] = true;
+		uzLog_levels[slot].store(static_cast<u8>(level), std::memory_order_relaxed);
+	}
+
+	void resetLogLevel(std::string_view category)
+	{
+		std::scoped_lock lock(s_levels_mutex);
+		const auto slot = getLevelSlot(category);
+		s_level_overridden[slot] = false;
+		uzLog_levels[slot].store(static_cast<u8>(s_default_level), std::memory_order_relaxed);
+	}
+
+	LogLevel getLogLevel(std::string_view category)
+	{
+		return static_cast<LogLevel>(uzLog_levels[getLevelSlot(category)].load(std::memory_order_relaxed));
+	}
+
+	static std::string_view getLevelName(LogLevel level)
+	{
+		switch (level)
+		{
+		case LL_Debug:
+			return "DEBUG";
+		case LL_Info:
+			return "INFO ";
+		case LL_Warn:
+			return "WARN ";
+		case LL_Error:
+			return "ERROR";
+		default:
+			return "UNKNOWN";
+		}
+	}
+
+	std::ostream& getOutputStream()
+	{
+		return *out_stream;
+	}
+
+	void StreamLogSink::write(std::string_view text)
+	{
+		m_out.write(text.data(), static_cast<std::streamsize>(text.size()));
+	}
+
+	void StreamLogSink::flush()
+	{
+		m_out.flush();
+	}
+
+	RotatingFileLogSink::RotatingFileLogSink(std::filesystem::path path, u64 max_size, u32 max_backups)
+		: m_path(std::move(path)), m_max_size(max_size), m_max_backups(max_backups)
+	{
+		m_file.open(m_path, std::ios::binary | std::ios::app);
+		std::error_code error;
+		const auto size = std::filesystem::file_size(m_path, error);
+		m_size = error ? 0 : size;
+	}
+
+	void RotatingFileLogSink::write(std::string_view text)
+	{
+		while (!text.empty() && m_file.is_open())
+		{
+			const u64 available = m_max_size > m_size ? m_max_size - m_size : 0;
+			u64 count = text.size();
+			if (count > available)
+			{
+				// Files are split at line boundaries, a line longer than max_size gets a file of its own
+				const auto line_end = available ? text.rfind('\n', available - 1) : std::string_view::npos;
+				if (line_end != std::string_view::npos)
+				{
+					count = line_end + 1;
+				}
+				else if (m_size > 0)
+				{
+					rotate();
+					continue;
+				}
+				else
+				{
+					count = std::min<u64>(text.find('\n'), text.size() - 1) + 1;
+				}
+			}
+
+			m_file.write(text.data(), static_cast<std::streamsize>(count));
+			m_size += count;
+			text.remove_prefix(count);
+		}
+	}
+
+	void RotatingFileLogSink::flush()
+	{
+		m_file.flush();
+	}
+
+	void RotatingFileLogSink::rotate()
+	{
+		m_file.close();
+
+		const auto getBackupPath = [&](u32 index)
+		{
+			auto path = m_path;
+			path += "." + std::to_string(index);
+			return path;
+		};
+
+		std::error_code error;
+		if (m_max_backups == 0)
+		{
+			std::filesystem::remove(m_path, error);
+		}
+		else
+		{
+			std::filesystem::remove(getBackupPath(m_max_backups), error);
+			for (u32 n = m_max_backups; n > 1; --n)
+			{
+				std::filesystem::rename(getBackupPath(n - 1), getBackupPath(n), error);
+			}
+			std::filesystem::rename(m_path, getBackupPath(1), error);
+		}
+
+		m_file.open(m_path, std::ios::binary | std::ios::trunc);
+		m_size = 0;
+	}
+
+	MemoryLogSink::MemoryLogSink(u64 capacity)
+	{
+		m_buffer.resize(capacity);
+	}
+
+	void MemoryLogSink::write(std::string_view text)
+	{
+		std::scoped_lock lock(m_mutex);
+		if (m_buffer.empty())
+			return;
+
+		if (text.size() >= m_buffer.size())
+		{
+			text = text.substr(text.size() - m_buffer.size());
+			m_wrapped = true;
+		}
+
+		const u64 first = std::min<u64>(text.size(), m_buffer.size() - m_position);
+		std::memcpy(m_buffer.data() + m_position, text.data(), first);
+		std::memcpy(m_buffer.data(), text.data() + first, text.size() - first);
+
+		m_wrapped |= m_position + text.size() >= m_buffer.size();
+		m_position = (m_position + text.size()) % m_buffer.size();
+	}
+
+	std::string MemoryLogSink::getContents() const
+	{
+		std::scoped_lock lock(m_mutex);
+		if (!m_wrapped)
+			return m_buffer.substr(0, m_position);
+
+		auto contents = m_buffer.substr(m_position) + m_buffer.substr(0, m_position);
+		// The oldest line is likely cut
+		const auto line_end = contents.find('\n');
+		if (line_end != std::string::npos)
+			contents.erase(0, line_end + 1);
+		return contents;
+	}
+
+	static std::atomic<LogFormat> s_format{ LogFormat::Text };
+
+	void setLogFormat(LogFormat format)
+	{
+		// Records already pushed are written in the previous format
+		flushLog();
+		s_format.store(format, std::memory_order_relaxed);
+	}
+
+	static u64 getTimestamp()
+	{
+		return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count());
+	}
+
+	// Single decoded message, whatever it was stored as
+	struct LogRecord
+	{
+		LogLevel level;
+		std::string_view category;
+		std::string_view file;
+		u64 line;
+		// Nanoseconds since the Unix epoch
+		u64 timestamp;
+		u32 thread;
+		std::string_view message;
+		// Key-value pairs of uzLogFields, encoded by log_args::write
+		const u8* fields{ nullptr };
+		u64 fields_size{ 0 };
+	};
+
+	struct LogArg
+	{
+		LogArgType type;
+		union
+		{
+			bool b;
+			char c;
+			i64 i;
+			u64 u;
+			double d;
+		};
+		std::string_view str;
+	};
+
+	// Arguments are trusted when they come from the ring buffer, but not when they're decoded from a file.
+	// Returns false if they're malformed
+	template <class Func>
+	static bool forEachArg(const u8* args, u64 size, Func&& func)
+	{
+		for (u64 n = 0; n < size;)
+		{
+			LogArg arg;
+			arg.type = static_cast<LogArgType>(args[n++]);
+			const auto read = [&](void* value, u64 value_size)
+			{
+				if (size - n < value_size)
+					return false;
+
+				std::memcpy(value, args + n, value_size);
+				n += value_size;
+				return true;
+			};
+
+			bool valid;
+			switch (arg.type)
+			{
+			case LogArgType::Bool:
+				valid = read(&arg.b, 1);
+				break;
+			case LogArgType::Char:
+				valid = read(&arg.c, 1);
+				break;
+			case LogArgType::Int:
+				valid = read(&arg.i, sizeof(arg.i));
+				break;
+			case LogArgType::UInt:
+			case LogArgType::Pointer:
+				valid = read(&arg.u, sizeof(arg.u));
+				break;
+			case LogArgType::Double:
+				valid = read(&arg.d, sizeof(arg.d));
+				break;
+			case LogArgType::String:
+			{
+				u32 length;
+				valid = read(&length, sizeof(length)) && size - n >= length;
+				if (valid)
+				{
+					arg.str = std::string_view(reinterpret_cast<const char*>(args + n), length);
+					n += length;
+				}
+				break;
+			}
+			default:
+				valid = false;
+			}
+
+			if (!valid)
+				return false;
+			func(arg);
+		}
+		return true;
+	}
+
+	static bool formatBinaryMessage(std::string& message, std::string_view format, const u8* args, u64 size)
+	{
+		fmt::dynamic_format_arg_store<fmt::format_context> store;
+		const bool valid = forEachArg(args, size, [&](const LogArg& arg)
+		{
+			switch (arg.type)
+			{
+			case LogArgType::Bool: store.push_back(arg.b); break;
+			case LogArgType::Char: store.push_back(arg.c); break;
+			case LogArgType::Int: store.push_back(arg.i); break;
+			case LogArgType::UInt: store.push_back(arg.u); break;
+			case LogArgType::Double: store.push_back(arg.d); break;
+			case LogArgType::Pointer: store.push_back(reinterpret_cast<const void*>(static_cast<std::uintptr_t>(arg.u))); break;
+			case LogArgType::String: store.push_back(arg.str); break;
+			}
+		});
+		if (!valid)
+			return false;
+
+		try
+		{
+			message = fmt::vformat(format, store);
+		}
+		catch (const fmt::format_error& e)
+		{
+			message = fmt::format("{} (cannot format: {})", format, e.what());
+		}
+		return true;
+	}
+
+	// Fields alternate between string keys and values
+	static bool isValidFields(const u8* fields, u64 size)
+	{
+		u64 index = 0;
+		bool valid_keys = true;
+		const bool valid = forEachArg(fields, size, [&](const LogArg& arg)
+		{
+			valid_keys &= index++ % 2 == 1 || arg.type == LogArgType::String;
+		});
+		return valid && valid_keys && index % 2 == 0;
+	}
+
+	static void appendArg(fmt::memory_buffer& out, const LogArg& arg, bool json)
+	{
+		const auto inserter = std::back_inserter(out);
+		switch (arg.type)
+		{
+		case LogArgType::Bool:
+			out.append(std::string_view(arg.b ? "true" : "false"));
+			break;
+		case LogArgType::Char:
+			if (json)
+				appendJsonString(out, std::string_view(&arg.c, 1));
+			else
+				out.push_back(arg.c);
+			break;
+		case LogArgType::Int:
+			fmt::format_to(inserter, "{}", arg.i);
+			break;
+		case LogArgType::UInt:
+			fmt::format_to(inserter, "{}", arg.u);
+			break;
+		case LogArgType::Double:
+			// JSON has no literals for infinity and NaN
+			if (json && !std::isfinite(arg.d))
+				fmt::format_to(inserter, "\"{}\"", arg.d);
+			else
+				fmt::format_to(inserter, "{}", arg.d);
+			break;
+		case LogArgType::Pointer:
+			fmt::format_to(inserter, json ? "\"{:#x}\"" : "{:#x}", arg.u);
+			break;
+		case LogArgType::String:
+			if (json)
+				appendJsonString(out, arg.str);
+			else
+				out.append(arg.str);
+			break;
+		}
+	}
+
+	// Fields must be validated by isValidFields
+	template <class Func>
+	static void forEachField(const LogRecord& record, Func&& func)
+	{
+		std::string_view key;
+		u64 index = 0;
+		forEachArg(record.fields, record.fields_size, [&](const LogArg& arg)
+		{
+			if (index++ % 2 == 0)
+				key = arg.str;
+			else
+				func(key, arg);
+		});
+	}
+
+	// `[LEVEL] Category: message`, with fields appended as `key=value`
+	static void appendTextRecord(fmt::memory_buffer& out, const LogRecord& record)
+	{
+		if (record.level == LL_Debug)
+			fmt::format_to(std::back_inserter(out), "[DEBUG] `{}`, line {}\n", record.file, record.line);
+		fmt::format_to(std::back_inserter(out), "[{}] {}: {}", getLevelName(record.level), record.category, record.message);
+
+		forEachField(record, [&](std::string_view key, const LogArg& value)
+		{
+			fmt::format_to(std::back_inserter(out), " {}=", key);
+			appendArg(out, value, false);
+		});
+		out.push_back('\n');
+	}
+
+	static void appendJsonRecord(fmt::memory_buffer& out, const LogRecord& record)
+	{
+		static constexpr std::string_view level_names[] = { "debug", "info", "warn", "error" };
+
+		fmt::format_to(std::back_inserter(out), "{{\"time\":{},\"thread\":{},\"level\":\"{}\",\"category\":",
+			record.timestamp, record.thread, record.level <= LL_Error ? level_names[record.level] : "unknown");
+		appendJsonString(out, record.category);
+		out.append(std::string_view(",\"file\":"));
+		appendJsonString(out, record.file);
+		fmt::format_to(std::back_inserter(out), ",\"line\":{},\"message\":", record.line);
+		appendJsonString(out, record.message);
+
+		if (record.fields_size)
+		{
+			out.append(std::string_view(",\"fields\":{"));
+			bool first = true;
+			forEachField(record, [&](std::string_view key, const LogArg& value)
+			{
+				if (!first)
+					out.push_back(',');
+				first = false;
+
+				appendJsonString(out, key);
+				out.push_back(':');
+				appendArg(out, value, true);
+			});
+			out.push_back('}');
+		}
+		out.append(std::string_view("}\n"));
+	}
+
+	static void appendRecord(fmt::memory_buffer& out, const LogRecord& record, LogFormat format)
+	{
+		if (format == LogFormat::Json)
+			appendJsonRecord(out, record);
+		else
+			appendTextRecord(out, record);
+	}
+
+	// Decodes a record of uzLogBinary or uzLogFields. Returns false if the arguments are malformed
+	static bool makeBinaryRecord(LogRecord& record, std::string& message, LogLevel level, std::string_view category,
+		std::string_view file, u32 line, std::string_view format, bool structured, const u8* args, u64 size)
+	{
+		record.level = level;
+		record.category = category;
+		record.file = file;
+		record.line = line;
+
+		if (structured)
+		{
+			if (!isValidFields(args, size))
+				return false;
+
+			record.message = format;
+			record.fields = args;
+			record.fields_size = size;
+			return true;
+		}
+
+		if (!formatBinaryMessage(message, format, args, size))
+			return false;
+
+		record.message = message;
+		return true;
 	}
 
-	void uzLog_ImplInfo(std::string_view log, std::string_view, u64)
+	// Format of initBinaryLogging: magic and version followed by records, each starting with its kind.
+	// A site is written once before its first event, events refer to it by index
+	namespace binary_log
 	{
+
+		constexpr char magic[] = { 'U', 'Z', 'L', 'O', 'G', '\0' };
+		constexpr u32 version = 2;
+
+		enum class RecordKind : u8
+		{
+			// u32 index, u8 level, u8 structured, u32 line, category, file and format strings
+			Site,
+			// u32 site index, u64 timestamp, u32 thread, u32 size of arguments, arguments encoded by log_args::write
+			Event,
+			// u8 level, u32 line, u64 timestamp, u32 thread, category, file and message strings
+			Text
+		};
+
+		// Guarded by s_mutex
+		static std::ostream* s_out{ nullptr };
+		static std::unordered_map<const LogSite*, u32> s_site_indices;
+
+		template <class T>
+		static void append(fmt::memory_buffer& out, const T& value)
+		{
+			const auto bytes = reinterpret_cast<const char*>(&value);
+			out.append(bytes, bytes + sizeof(T));
+		}
+
+		static void appendString(fmt::memory_buffer& out, std::string_view str)
+		{
+			append(out, static_cast<u32>(str.size()));
+			out.append(str.data(), str.data() + str.size());
+		}
+
+		static void appendText(fmt::memory_buffer& out, const LogRecord& record)
+		{
+			append(out, RecordKind::Text);
+			append(out, static_cast<u8>(record.level));
+			append(out, static_cast<u32>(record.line));
+			append(out, record.timestamp);
+			append(out, record.thread);
+			appendString(out, record.category);
+			appendString(out, record.file);
+			appendString(out, record.message);
+		}
+
+		static void appendEvent(fmt::memory_buffer& out, const LogSite& site, u64 timestamp, u32 thread,
+			const u8* args, u64 size)
+		{
+			auto [it, inserted] = s_site_indices.emplace(&site, static_cast<u32>(s_site_indices.size()));
+			if (inserted)
+			{
+				append(out, RecordKind::Site);
+				append(out, it->second);
+				append(out, static_cast<u8>(site.level));
+				append(out, static_cast<u8>(site.structured));
+				append(out, site.line);
+				appendString(out, site.category);
+				appendString(out, site.file);
+				appendString(out, site.format);
+			}
+
+			append(out, RecordKind::Event);
+			append(out, it->second);
+			append(out, timestamp);
+			append(out, thread);
+			append(out, static_cast<u32>(size));
+			out.append(args, args + size);
+		}
+
+		static void write(const fmt::memory_buffer& out)
+		{
+			s_out->write(out.data(), static_cast<std::streamsize>(out.size()));
+		}
+
+	}
+
+	// Writes a single record outside of the logging thread
+	static void writeRecord(const LogRecord& record)
+	{
+		fmt::memory_buffer out;
 		std::scoped_lock lock(s_mutex);
-		getOutputStream() << fmt::format(log_format_str, "INFO ", log) << "\n";
+		if (binary_log::s_out)
+		{
+			binary_log::appendText(out, record);
+			binary_log::write(out);
+			return;
+		}
+
+		appendRecord(out, record, s_format.load(std::memory_order_relaxed));
+		writeText({ out.data(), out.size() }, record.level >= LL_Error);
+	}
+
+#if UZE_PLATFORM != UZE_PLATFORM_WEB
+	namespace async_log
+	{
+
+		constexpr u8 padding_level = 0xff;
+		// Payload is a pointer to the LogSite followed by encoded arguments
+		constexpr u8 binary_level = 0xfe;
+		// Message is text of writeLogOutput, only the latest one of a batch is written
+		constexpr u8 output_level = 0xfd;
+
+		// Followed by category name, file and message, records are aligned to 8 bytes.
+		// Padding records may be shorter than the header and only have size and level
+		struct RecordHeader
+		{
+			u32 size;
+			u8 level;
+			u16 category_size;
+			u32 line;
+			u32 log_size;
+			u16 file_size;
+			u32 thread;
+			u64 timestamp;
+		};
+
+		constexpr u64 record_alignment = 8;
+		constexpr u64 padding_record_size = offsetof(RecordHeader, line);
+		static_assert(padding_record_size <= record_alignment);
+
+		// Single producer, single consumer. Positions grow monotonically and are masked on access
+		struct Ring
+		{
+			explicit Ring(u64 capacity_) : capacity(capacity_), data(new u8[capacity_]) {}
+
+			const u64 capacity;
+			const std::unique_ptr<u8[]> data;
+			const u32 thread{ getThreadIndex() };
+
+			alignas(64) std::atomic<u64> head{ 0 };
+			// Owned by the producer, a cached copy of tail avoids touching the consumer's cache line
+			u64 cached_tail{ 0 };
+			// Head after the record being written, published by commit
+			u64 reserved_head{ 0 };
+			std::atomic<u64> dropped{ 0 };
+			std::atomic<bool> abandoned{ false };
+
+			alignas(64) std::atomic<u64> tail{ 0 };
+
+			// Records longer than a quarter of the ring are truncated or formatted on the caller thread,
+			// so a single message can't starve the rest
+			u64 getMaxRecordSize() const { return capacity / 4; }
+		};
+
+		static std::atomic<bool> s_running{ false };
+		static LogOverflowPolicy s_policy{ LogOverflowPolicy::Drop };
+		static u64 s_buffer_size{ 0 };
+		static std::atomic<u64> s_dropped{ 0 };
+
+		static std::mutex s_rings_mutex;
+		static std::vector<std::shared_ptr<Ring>> s_rings;
+
+		static std::thread s_thread;
+		static std::mutex s_wake_mutex;
+		static std::condition_variable s_wake;
+		static std::condition_variable s_flushed;
+		static bool s_wake_requested{ false };
+		static u64 s_flush_requested{ 0 };
+		static u64 s_flush_done{ 0 };
+
+		static void wakeUp()
+		{
+			{
+				std::scoped_lock lock(s_wake_mutex);
+				s_wake_requested = true;
+			}
+			s_wake.notify_one();
+		}
+
+		struct RingHandle
+		{
+			std::shared_ptr<Ring> ring;
+
+			~RingHandle()
+			{
+				// Logging thread drains the ring and then releases it
+				if (ring)
+					ring->abandoned.store(true, std::memory_order_release);
+			}
+		};
+
+		static thread_local RingHandle t_ring;
+
+		static Ring& getThreadRing()
+		{
+			if (!t_ring.ring)
+			{
+				u64 capacity = 1024;
+				while (capacity < s_buffer_size)
+					capacity *= 2;
+
+				t_ring.ring = std::make_shared<Ring>(capacity);
+				std::scoped_lock lock(s_rings_mutex);
+				s_rings.push_back(t_ring.ring);
+			}
+			return *t_ring.ring;
+		}
+
+		static constexpr u64 alignRecord(u64 size)
+		{
+			return (size + record_alignment - 1) & ~(record_alignment - 1);
+		}
+
+		// Returns storage for a record of `size` bytes, or null if it doesn't fit and the policy is Drop.
+		// The record is published by commit
+		static u8* reserve(Ring& ring, u64 size)
+		{
+			const u64 head = ring.head.load(std::memory_order_relaxed);
+			const u64 offset = head & (ring.capacity - 1);
+			// Record never wraps around, the rest of the ring is skipped with a padding record instead
+			const u64 padding = offset + size > ring.capacity ? ring.capacity - offset : 0;
+
+			while (head + padding + size - ring.cached_tail > ring.capacity)
+			{
+				ring.cached_tail = ring.tail.load(std::memory_order_acquire);
+				if (head + padding + size - ring.cached_tail <= ring.capacity)
+					break;
+
+				if (s_policy == LogOverflowPolicy::Drop || !s_running.load(std::memory_order_relaxed))
+				{
+					ring.dropped.fetch_add(1, std::memory_order_relaxed);
+					return nullptr;
+				}
+
+				wakeUp();
+				std::this_thread::yield();
+			}
+
+			if (padding)
+			{
+				RecordHeader header{};
+				header.size = static_cast<u32>(padding);
+				header.level = padding_level;
+				std::memcpy(ring.data.get() + offset, &header, padding_record_size);
+			}
+
+			ring.reserved_head = head + padding + size;
+			return ring.data.get() + ((head + padding) & (ring.capacity - 1));
+		}
+
+		static void commit(Ring& ring)
+		{
+			ring.head.store(ring.reserved_head, std::memory_order_release);
+		}
+
+		// Level is a LogLevel or output_level
+		static void push(Ring& ring, u8 level, std::string_view category, std::string_view log,
+			std::string_view file, u64 line)
+		{
+			const u64 max_size = ring.getMaxRecordSize();
+			category = category.substr(0, 0xffff);
+			file = file.substr(0, 0xffff);
+			if (sizeof(RecordHeader) + category.size() + file.size() >= max_size)
+				file = {};
+			log = log.substr(0, max_size - std::min(max_size, sizeof(RecordHeader) + category.size() + file.size()));
+
+			const u64 size = alignRecord(sizeof(RecordHeader) + category.size() + file.size() + log.size());
+			u8* record = reserve(ring, size);
+			if (!record)
+				return;
+
+			RecordHeader header{};
+			header.size = static_cast<u32>(size);
+			header.line = static_cast<u32>(line);
+			header.log_size = static_cast<u32>(log.size());
+			header.category_size = static_cast<u16>(category.size());
+			header.file_size = static_cast<u16>(file.size());
+			header.level = level;
+			header.thread = ring.thread;
+			header.timestamp = getTimestamp();
+			std::memcpy(record, &header, sizeof(header));
+			record += sizeof(header);
+			std::memcpy(record, category.data(), category.size());
+			record += category.size();
+			std::memcpy(record, file.data(), file.size());
+			record += file.size();
+			std::memcpy(record, log.data(), log.size());
+
+			commit(ring);
+		}
+
+		// Formats or encodes every record published so far into out. Called with s_mutex locked
+		static void drain(Ring& ring, fmt::memory_buffer& out, std::string& output, LogFormat format)
+		{
+			const u64 head = ring.head.load(std::memory_order_acquire);
+			u64 tail = ring.tail.load(std::memory_order_relaxed);
+			std::string message;
+
+			while (tail != head)
+			{
+				const u8* record = ring.data.get() + (tail & (ring.capacity - 1));
+				RecordHeader header{};
+				std::memcpy(&header, record, padding_record_size);
+				tail += header.size;
+				if (header.level == padding_level)
+					continue;
+
+				std::memcpy(&header, record, sizeof(header));
+
+				if (header.level == output_level)
+				{
+					output.assign(reinterpret_cast<const char*>(record + sizeof(header)), header.log_size);
+					continue;
+				}
+
+				if (header.level == binary_level)
+				{
+					const LogSite* site;
+					std::memcpy(&site, record + sizeof(header), sizeof(site));
+					const u8* args = record + sizeof(header) + sizeof(site);
+
+					LogRecord decoded{};
+					decoded.timestamp = header.timestamp;
+					decoded.thread = header.thread;
+					if (binary_log::s_out)
+						binary_log::appendEvent(out, *site, header.timestamp, header.thread, args, header.log_size);
+					else if (makeBinaryRecord(decoded, message, site->level, site->category, site->file, site->line,
+						site->format, site->structured, args, header.log_size))
+						appendRecord(out, decoded, format);
+					continue;
+				}
+
+				const char* text = reinterpret_cast<const char*>(record + sizeof(header));
+				LogRecord decoded{};
+				decoded.level = static_cast<LogLevel>(header.level);
+				decoded.category = { text, header.category_size };
+				decoded.file = { text + header.category_size, header.file_size };
+				decoded.line = header.line;
+				decoded.timestamp = header.timestamp;
+				decoded.thread = header.thread;
+				decoded.message = { text + header.category_size + header.file_size, header.log_size };
+
+				if (binary_log::s_out)
+					binary_log::appendText(out, decoded);
+				else
+					appendRecord(out, decoded, format);
+			}
+
+			ring.tail.store(tail, std::memory_order_release);
+		}
+
+		// Drains all rings and writes them with a single write to the output stream
+		static void drainAll(fmt::memory_buffer& out)
+		{
+			std::vector<std::shared_ptr<Ring>> rings;
+			{
+				std::scoped_lock lock(s_rings_mutex);
+				rings = s_rings;
+			}
+
+			std::string output;
+			std::scoped_lock lock(s_mutex);
+			const auto format = s_format.load(std::memory_order_relaxed);
+			u64 dropped = 0;
+			for (const auto& ring : rings)
+			{
+				// Abandoned flag is read before draining, so records pushed before the thread exited are written
+				const bool abandoned = ring->abandoned.load(std::memory_order_acquire);
+				drain(*ring, out, output, format);
+				dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+
+				if (abandoned)
+				{
+					std::scoped_lock rings_lock(s_rings_mutex);
+					s_rings.erase(std::find(s_rings.begin(), s_rings.end(), ring));
+				}
+			}
+
+			if (dropped)
+			{
+				s_dropped.fetch_add(dropped, std::memory_order_relaxed);
+				const auto message = fmt::format("Dropped {} messages, log buffer is full", dropped);
+				const LogRecord record{ LL_Warn, "Log", __FILE__, __LINE__, getTimestamp(), getThreadIndex(), message };
+				if (binary_log::s_out)
+					binary_log::appendText(out, record);
+				else
+					appendRecord(out, record, format);
+			}
+
+			if (out.size())
+			{
+				if (binary_log::s_out)
+				{
+					binary_log::write(out);
+					binary_log::s_out->flush();
+				}
+				else
+				{
+					writeText({ out.data(), out.size() }, true);
+				}
+				out.clear();
+			}
+
+			// After the batch, so a status line stays below the messages
+			if (!output.empty())
+			{
+				getOutputStream().write(output.data(), static_cast<std::streamsize>(output.size()));
+				getOutputStream().flush();
+			}
+		}
+
+		static void loggingThread()
+		{
+			fmt::memory_buffer out;
+			while (true)
+			{
+				u64 flush_request;
+				bool running;
+				{
+					std::unique_lock lock(s_wake_mutex);
+					s_wake.wait_for(lock, std::chrono::milliseconds(5), [] { return s_wake_requested; });
+					s_wake_requested = false;
+					flush_request = s_flush_requested;
+					running = s_running.load(std::memory_order_relaxed);
+				}
+
+				drainAll(out);
+
+				{
+					std::scoped_lock lock(s_wake_mutex);
+					s_flush_done = flush_request;
+				}
+				s_flushed.notify_all();
+
+				if (!running)
+					break;
+			}
+		}
+
+		// Stops the logging thread at exit if the engine didn't
+		struct Shutdown
+		{
+			~Shutdown() { stopAsyncLogging(); }
+		};
+		static Shutdown s_shutdown;
+
+	}
+#endif
+
+	void startAsyncLogging(LogOverflowPolicy policy, u64 buffer_size)
+	{
+#if UZE_PLATFORM != UZE_PLATFORM_WEB
+		using namespace async_log;
+		if (s_running)
+			return;
+
+		s_policy = policy;
+		s_buffer_size = buffer_size;
+		s_running = true;
+		s_thread = std::thread(loggingThread);
+#endif
+	}
+
+	void stopAsyncLogging()
+	{
+#if UZE_PLATFORM != UZE_PLATFORM_WEB
+		using namespace async_log;
+		if (!s_running)
+			return;
+
+		{
+			std::scoped_lock lock(s_wake_mutex);
+			s_running = false;
+			s_wake_requested = true;
+		}
+		s_wake.notify_one();
+		s_thread.join();
+
+		// Catches messages pushed after the last pass of the logging thread
+		fmt::memory_buffer out;
+		drainAll(out);
+#endif
+	}
+
+	void flushLog()
+	{
+#if UZE_PLATFORM != UZE_PLATFORM_WEB
+		using namespace async_log;
+		std::unique_lock lock(s_wake_mutex);
+		if (!s_running)
+			return;
+
+		const u64 request = ++s_flush_requested;
+		s_wake_requested = true;
+		s_wake.notify_one();
+		s_flushed.wait(lock, [&] { return s_flush_done >= request || !s_running; });
+#endif
 	}
 
-	void uzLog_ImplWarn(std::string_view log, std::string_view, u64)
+	void writeLogOutput(std::string_view text)
 	{
+#if UZE_PLATFORM != UZE_PLATFORM_WEB
+		using namespace async_log;
+		if (s_running.load(std::memory_order_acquire))
+		{
+			// Written by the logging thread with its next batch, the caller never takes s_mutex
+			push(getThreadRing(), output_level, {}, text, {}, 0);
+			return;
+		}
+#endif
 		std::scoped_lock lock(s_mutex);
-		getOutputStream() << fmt::format(log_format_str, "WARN ", log) << "\n";
+		getOutputStream().write(text.data(), static_cast<std::streamsize>(text.size()));
+		getOutputStream().flush();
 	}
 
-	void uzLog_ImplError(std::string_view log, std::string_view, u64)
+	u64 getNumDroppedLogs()
 	{
+#if UZE_PLATFORM != UZE_PLATFORM_WEB
+		return async_log::s_dropped.load(std::memory_order_relaxed);
+#else
+		return 0;
+#endif
+	}
+
+	void initBinaryLogging(std::ostream* out)
+	{
+		// Records already pushed go to the previous output
+		flushLog();
+
 		std::scoped_lock lock(s_mutex);
-		getOutputStream() << fmt::format(log_format_str, "ERROR", log) << "\n";
+		binary_log::s_out = out;
+		binary_log::s_site_indices.clear();
+		if (out)
+		{
+			out->write(binary_log::magic, sizeof(binary_log::magic));
+			out->write(reinterpret_cast<const char*>(&binary_log::version), sizeof(binary_log::version));
+		}
 	}
 
-	void uzLog_ImplUnknown(std::string_view log, std::string_view file, u64 line)
+	bool decodeBinaryLog(std::istream& in, std::ostream& out, LogFormat format)
 	{
+		struct Site
+		{
+			LogLevel level;
+			bool structured;
+			u32 line;
+			std::string category;
+			std::string file;
+			std::string format;
+		};
+
+		const auto read = [&](auto& value)
+		{
+			return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+		};
+		const auto readString = [&](std::string& str)
+		{
+			u32 size;
+			if (!read(size))
+				return false;
+
+			str.resize(size);
+			return static_cast<bool>(in.read(str.data(), size));
+		};
+
+		char magic[sizeof(binary_log::magic)];
+		u32 version;
+		if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, binary_log::magic, sizeof(magic)) != 0
+			|| !read(version) || version != binary_log::version)
+			return false;
+
+		std::vector<Site> sites;
+		std::vector<u8> args;
+		std::string category, file, message;
+		fmt::memory_buffer buffer;
+
+		binary_log::RecordKind kind;
+		while (read(kind))
+		{
+			LogRecord record{};
+			u8 level;
+			u32 line;
+			switch (kind)
+			{
+			case binary_log::RecordKind::Site:
+			{
+				u32 index;
+				u8 structured;
+				Site site;
+				if (!read(index) || !read(level) || !read(structured) || !read(site.line) || !readString(site.category)
+					|| !readString(site.file) || !readString(site.format))
+					return false;
+
+				// Sites are numbered in order of appearance, a larger index means the file is corrupted
+				if (index > sites.size())
+					return false;
+
+				site.level = static_cast<LogLevel>(level);
+				site.structured = structured != 0;
+				if (index == sites.size())
+					sites.push_back(std::move(site));
+				else
+					sites[index] = std::move(site);
+				break;
+			}
+			case binary_log::RecordKind::Event:
+			{
+				u32 index, size;
+				if (!read(index) || !read(record.timestamp) || !read(record.thread) || !read(size) || index >= sites.size())
+					return false;
+
+				args.resize(size);
+				if (!in.read(reinterpret_cast<char*>(args.data()), size))
+					return false;
+
+				const auto& site = sites[index];
+				if (!makeBinaryRecord(record, message, site.level, site.category, site.file, site.line,
+					site.format, site.structured, args.data(), size))
+					return false;
+				appendRecord(buffer, record, format);
+				break;
+			}
+			case binary_log::RecordKind::Text:
+				if (!read(level) || !read(line) || !read(record.timestamp) || !read(record.thread)
+					|| !readString(category) || !readString(file) || !readString(message))
+					return false;
+
+				record.level = static_cast<LogLevel>(level);
+				record.category = category;
+				record.file = file;
+				record.line = line;
+				record.message = message;
+				appendRecord(buffer, record, format);
+				break;
+			default:
+				return false;
+			}
+
+			if (buffer.size() >= 64 * 1024)
+			{
+				out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+				buffer.clear();
+			}
+		}
+
+		out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		return in.eof() && in.gcount() == 0;
+	}
+
+	void uzLog_Impl(const LogCategory& category, LogLevel level, std::string_view log,
+		std::string_view file, u64 line)
+	{
+#if UZE_PLATFORM != UZE_PLATFORM_WEB
+		using namespace async_log;
+		if (s_running.load(std::memory_order_acquire))
+		{
+			push(getThreadRing(), static_cast<u8>(level), category.name, log, file, line);
+			if (level == LL_Error)
+				wakeUp();
+			return;
+		}
+#endif
+
+		writeRecord({ level, category.name, file, line, getTimestamp(), getThreadIndex(), log });
+	}
+
+	// Arguments are encoded here when they can't go into the ring buffer
+	static thread_local std::vector<u8> t_binary_args;
+#if UZE_PLATFORM != UZE_PLATFORM_WEB
+	static thread_local async_log::Ring* t_binary_ring{ nullptr };
+#endif
+
+	u8* uzLog_BeginBinary(const LogSite& site, u64 size)
+	{
+#if UZE_PLATFORM != UZE_PLATFORM_WEB
+		using namespace async_log;
+		t_binary_ring = nullptr;
+		if (s_running.load(std::memory_order_acquire))
+		{
+			auto& ring = getThreadRing();
+			const u64 record_size = alignRecord(sizeof(RecordHeader) + sizeof(const LogSite*) + size);
+			if (record_size <= ring.getMaxRecordSize())
+			{
+				u8* record = reserve(ring, record_size);
+				if (!record)
+					return nullptr;
+
+				RecordHeader header{};
+				header.size = static_cast<u32>(record_size);
+				header.level = binary_level;
+				header.log_size = static_cast<u32>(size);
+				header.thread = ring.thread;
+				header.timestamp = getTimestamp();
+				std::memcpy(record, &header, sizeof(header));
+				const LogSite* site_pointer = &site;
+				std::memcpy(record + sizeof(header), &site_pointer, sizeof(site_pointer));
+
+				t_binary_ring = &ring;
+				return record + sizeof(header) + sizeof(site_pointer);
+			}
+		}
+#endif
+
+		t_binary_args.resize(size);
+		return t_binary_args.data();
+	}
+
+	void uzLog_EndBinary(const LogSite& site)
+	{
+#if UZE_PLATFORM != UZE_PLATFORM_WEB
+		if (t_binary_ring)
+		{
+			async_log::commit(*t_binary_ring);
+			if (site.level == LL_Error)
+				async_log::wakeUp();
+			return;
+		}
+#endif
+
+		// Written on the caller thread, either logging is synchronous or the arguments are too long for the ring
+		const u64 timestamp = getTimestamp();
+		fmt::memory_buffer out;
 		std::scoped_lock lock(s_mutex);
-		uzLog_ImplWarn(fmt::format("Unknown log level at `{}`, line {}", file, line), file, line);
-		getOutputStream() << fmt::format(log_format_str, "UNKNOWN", log) << "\n";
+		if (binary_log::s_out)
+		{
+			binary_log::appendEvent(out, site, timestamp, getThreadIndex(), t_binary_args.data(), t_binary_args.size());
+			binary_log::write(out);
+			return;
+		}
+
+		LogRecord record{};
+		record.timestamp = timestamp;
+		record.thread = getThreadIndex();
+		std::string message;
+		if (makeBinaryRecord(record, message, site.level, site.category, site.file, site.line, site.format,
+			site.structured, t_binary_args.data(), t_binary_args.size()))
+		{
+			appendRecord(out, record, s_format.load(std::memory_order_relaxed));
+			writeText({ out.data(), out.size() }, site.level >= LL_Error);
+		}
 	}
 
-	std::ostream& getOutputStream()
+	bool LogRateLimit::allow(u32 max_per_second, u32& suppressed_before)
 	{
-		return *out_stream;
+		const u64 now = static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+		u64 start = window_start.load(std::memory_order_relaxed);
+		suppressed_before = 0;
+
+		if (now - start >= 1'000'000'000ull && window_start.compare_exchange_strong(start, now, std::memory_order_relaxed))
+		{
+			count.store(1, std::memory_order_relaxed);
+			suppressed_before = suppressed.exchange(0, std::memory_order_relaxed);
+			return true;
+		}
+
+		if (count.fetch_add(1, std::memory_order_relaxed) < max_per_second)
+			return true;
+
+		suppressed.fetch_add(1, std::memory_order_relaxed);
+		return false;
 	}
 
 }
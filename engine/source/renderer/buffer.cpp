@@ -9,6 +9,8 @@ namespace uze
 	static u32 s_currently_bound_index_buffer{ 0 };
 	static u32 s_currently_bound_uniform_buffer{ 0 };
 
+	static constexpr LogCategory log_buffer { "Buffer" };
+
 	VertexBuffer::VertexBuffer(const BufferSpecification& spec, Renderer& renderer)
 		: m_renderer(renderer)
 	{
@@ -19,13 +21,110 @@ namespace uze
 		glCheck(glBufferData(GL_ARRAY_BUFFER, m_size, spec.data, m_usage));
 		if (spec.data)
 			renderer.onDataTransfer(m_size);
+
+		if (spec.num_stream_regions)
+		{
+			m_num_regions = spec.num_stream_regions;
+			m_region_size = m_size / m_num_regions;
+			m_fences.resize(m_num_regions, nullptr);
+			// Region 0 is used first
+			m_region = m_num_regions - 1;
+#if UZE_GL != UZE_OPENGL33
+			m_staging = std::make_unique<u8[]>(m_region_size);
+#endif
+		}
 	}
 
 	VertexBuffer::~VertexBuffer()
 	{
+		if (m_mapped && !m_staging)
+		{
+			bind();
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+		}
+		for (void* fence : m_fences)
+		{
+			if (fence)
+				glDeleteSync(static_cast<GLsync>(fence));
+		}
 		glDeleteBuffers(1, &m_handle);
 	}
 
+	void* VertexBuffer::mapRegion()
+	{
+		if (!m_num_regions || m_mapped)
+			return nullptr;
+
+		m_mapped = true;
+		if (m_staging)
+			return m_staging.get();
+
+		if (m_fence_pending)
+		{
+			// Draws reading the previous region were submitted since it was unmapped
+			m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			m_fence_pending = false;
+		}
+		m_region = (m_region + 1) % m_num_regions;
+
+		if (GLsync fence = static_cast<GLsync>(m_fences[m_region]))
+		{
+			// Only waits when the GPU is more than num_regions batches behind
+			while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+			glDeleteSync(fence);
+			m_fences[m_region] = nullptr;
+		}
+
+		if (!isBound())
+			bind();
+		void* data = glMapBufferRange(GL_ARRAY_BUFFER, static_cast<GLintptr>(m_region) * m_region_size, m_region_size,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+		if (!data)
+		{
+			// Writers always get memory, from now on it's uploaded like on GLES
+			uzLog(log_buffer, Warn, "Cannot map region {} of streaming vertex buffer, using a staging copy instead", m_region);
+			m_staging = std::make_unique<u8[]>(m_region_size);
+			return m_staging.get();
+		}
+		return data;
+	}
+
+	u64 VertexBuffer::unmapRegion(u64 size)
+	{
+		if (!m_mapped)
+			return 0;
+
+		m_mapped = false;
+		if (m_staging)
+		{
+			if (size)
+			{
+				if (!isBound())
+					bind();
+				// Orphaning gives a fresh buffer when the GPU still reads the old one, without a sync
+				glBufferData(GL_ARRAY_BUFFER, m_size, nullptr, m_usage);
+				glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(size), m_staging.get());
+				m_renderer.onDataTransfer(size);
+			}
+			// The staging copy always starts at the beginning of the buffer, no fences are needed
+			return 0;
+		}
+
+		if (!isBound())
+			bind();
+		if (size)
+			glFlushMappedBufferRange(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(size));
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		m_renderer.onDataTransfer(size);
+		m_fence_pending = size > 0;
+
+		const u64 offset = static_cast<u64>(m_region) * m_region_size;
+		// Nothing was written, the next mapRegion reuses the region
+		if (!size)
+			m_region = (m_region + m_num_regions - 1) % m_num_regions;
+		return offset;
+	}
+
 	void VertexBuffer::updateData(const void* data, i64 size, i64 offset)
 	{
 		if (!isBound())
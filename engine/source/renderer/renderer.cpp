@@ -2,13 +2,16 @@
 #include "opengl.h"
 
 #include <array>
+#include <cstddef>
 #include <iomanip>
 #include <sstream>
 
 #include "uze/renderer/vertex_array.h"
+#include "uze/core/profiler.h"
 
 #include <glm/glm.hpp>
 #include <glm/ext/matrix_clip_space.hpp>
+#include <glm/gtc/packing.hpp>
 
 #include "glm/ext/matrix_transform.hpp"
 
@@ -47,13 +50,15 @@ namespace uze
 
 	void logOpenGLError(u32 err, const char* file, u64 line)
 	{
-		uzLog(log_renderer, Error, "`{}`, line {}", std::filesystem::path(file).filename().generic_string(), line);
-		uzLog(log_renderer, Error, "OpenGL Error: {}", openGLErrorToString(err));
+		// glCheck in a per-frame path would otherwise repeat the same error every frame
+		uzLogLimited(log_renderer, Error, 10, "OpenGL Error: {} at `{}`, line {}", openGLErrorToString(err),
+			std::filesystem::path(file).filename().generic_string(), line);
 	}
 
 	namespace
 	{
-		bool createGLContext(i32 major, i32 minor, SDL_Window*& window, SDL_GLContext& gl_context)
+		bool createGLContext(i32 major, i32 minor, const RendererSpecification& spec, SDL_Window*& window,
+			SDL_GLContext& gl_context)
 		{
 			SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, major);
 			SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, minor);
@@ -64,7 +69,10 @@ namespace uze
 			SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES);
 #endif
 
-			window = SDL_CreateWindow("Uzlezz Engine Window", 1600, 900, SDL_WINDOW_OPENGL);
+			// Headless mode still needs a window for the context, its default framebuffer isn't used
+			const u32 window_flags = SDL_WINDOW_OPENGL | (spec.headless ? SDL_WINDOW_HIDDEN : 0);
+			window = SDL_CreateWindow("Uzlezz Engine Window", static_cast<i32>(spec.width),
+				static_cast<i32>(spec.height), window_flags);
 			if (!window) return false;
 
 #if UZE_PLATFORM == UZE_PLATFORM_WEB
@@ -104,6 +112,8 @@ namespace uze
 	constexpr u64 max_quads_in_one_batch = 20000;
 	constexpr u64 max_quad_vertices = max_quads_in_one_batch * quad_vertex_count;
 	constexpr u64 max_quad_indices = max_quads_in_one_batch * quad_index_count;
+	// Batches written ahead of the GPU before one has to wait
+	constexpr u32 num_quad_buffer_regions = 3;
 
 	struct SceneData
 	{
@@ -117,6 +127,21 @@ namespace uze
 		glm::vec4 color;
 	};
 
+	// A quarter of the four QuadVertex of a quad
+	struct QuadInstance
+	{
+		// First two columns of the 2D transform
+		glm::vec4 basis;
+		glm::vec2 translation;
+		u32 color;
+		float tex_index;
+	};
+
+	// Has to match the instance layout built in the Renderer constructor, attributes are tightly packed
+	static_assert(sizeof(QuadInstance) == 32);
+	static_assert(offsetof(QuadInstance, translation) == 16 && offsetof(QuadInstance, color) == 24
+		&& offsetof(QuadInstance, tex_index) == 28);
+
 	struct BatchData
 	{
 		std::shared_ptr<VertexArray> quad_vertex_array;
@@ -124,9 +149,17 @@ namespace uze
 		std::shared_ptr<IndexBuffer> quad_index_buffer;
 		std::shared_ptr<Shader> quad_shader;
 
-		std::unique_ptr<QuadVertex[]> quad_vertices_base{ nullptr };
+		// Points into the mapped region of quad_vertex_buffer
+		QuadVertex* quad_vertices_base{ nullptr };
 		QuadVertex* quad_vertices_ptr{ nullptr };
 
+		// Used instead of quad vertices with RendererSpecification::instanced_quads
+		QuadInstance* quad_instances_base{ nullptr };
+		QuadInstance* quad_instances_ptr{ nullptr };
+		u32 num_quad_instances{ 0 };
+		// Where the instance attributes of quad_vertex_array currently point
+		u64 quad_instance_offset{ 0 };
+
 		u32 quad_index_count{ 0 };
 		std::array<glm::vec2, quad_vertex_count> quad_vertex_positions;
 
@@ -135,9 +168,74 @@ namespace uze
 		glm::mat4 view_projection{ 1.0f };
 	};
 
-	Renderer::Renderer()
+	// Timer queries of a frame are read this many frames later, when the GPU has surely finished them
+	constexpr u64 gpu_timer_latency = 4;
+	// End query of a scope which wasn't ended before the end of the frame
+	constexpr u32 unfinished_scope = ~0u;
+
+	struct GpuTimerFrame
 	{
-		if (SDL_Init(SDL_INIT_VIDEO) != 0) return;
+		struct Scope
+		{
+			const char* name;
+			u32 depth;
+			u32 begin_query;
+			u32 end_query;
+		};
+
+		// Grows to the largest number of queries a frame has used, two per scope
+		std::vector<u32> queries;
+		u32 num_used_queries{ 0 };
+		std::vector<Scope> scopes;
+		bool pending{ false };
+		// Number of the frame in FrameStatistics, its gpu_ms is filled in when the queries finish
+		u64 frame_number{ 0 };
+	};
+
+	struct GpuTimerData
+	{
+		bool supported{ false };
+		std::array<GpuTimerFrame, gpu_timer_latency> frames;
+		u64 frame_index{ 0 };
+		std::vector<u32> open_scopes;
+		std::vector<GpuTiming> timings;
+
+		GpuTimerFrame& getCurrentFrame() { return frames[frame_index % gpu_timer_latency]; }
+
+		u32 writeTimestamp()
+		{
+			auto& frame = getCurrentFrame();
+			if (frame.num_used_queries == frame.queries.size())
+			{
+				u32 query = 0;
+				glGenQueries(1, &query);
+				frame.queries.push_back(query);
+			}
+
+			const u32 index = frame.num_used_queries++;
+#if UZE_GL == UZE_OPENGL33
+			glQueryCounter(frame.queries[index], GL_TIMESTAMP);
+#endif
+			return index;
+		}
+	};
+
+	Renderer::Renderer(const RendererSpecification& spec)
+		: m_spec(spec)
+	{
+		if (SDL_Init(SDL_INIT_VIDEO) != 0)
+		{
+			if (!m_spec.headless)
+				return;
+
+			uzLog(log_renderer, Info, "Cannot init video ({}), trying offscreen video driver", SDL_GetError());
+			SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+			if (SDL_Init(SDL_INIT_VIDEO) != 0)
+			{
+				uzLog(log_renderer, Error, "Cannot init offscreen video driver: {}", SDL_GetError());
+				return;
+			}
+		}
 
 		int rendererFlags = 0;
 #if defined(_DEBUG)
@@ -153,17 +251,19 @@ namespace uze
 		SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
 
 #if UZE_GL == UZE_OPENGLES30
-		if (!createGLContext(3, 0, m_window, m_gl_context))
+		if (!createGLContext(3, 0, m_spec, m_window, m_gl_context))
 			return;
 #else
-		if (!createGLContext(3, 3, m_window, m_gl_context))
+		if (!createGLContext(3, 3, m_spec, m_window, m_gl_context))
 			return;
 #endif
 		SDL_GL_MakeCurrent(m_window, m_gl_context);
 
 
+		if (!m_spec.vsync || m_spec.headless)
+			SDL_GL_SetSwapInterval(0);
 		// Try to enable adaptive V-Sync
-		if (SDL_GL_SetSwapInterval(-1) != 0)
+		else if (SDL_GL_SetSwapInterval(-1) != 0)
 			// If there's no support for adaptive V-Sync,
 			// Enable standard V-Sync
 			SDL_GL_SetSwapInterval(1);
@@ -196,10 +296,24 @@ namespace uze
 		uzLog(log_renderer, Info, "Renderer: {}",
 			reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
 		uzLog(log_renderer, Info, "Available texture units: {}", num_texture_units);
+		if (m_spec.headless)
+			uzLog(log_renderer, Info, "Headless, rendering to a {}x{} framebuffer", m_spec.width, m_spec.height);
 		uzLog(log_renderer, Info, "########################### RENDERER INFO ###########################");
 
+		if (m_spec.headless && !createFramebuffer())
+		{
+			uzLog(log_renderer, Error, "Cannot create offscreen framebuffer");
+			return;
+		}
+
 		m_scene_data = std::make_unique<SceneData>();
 		m_batch_data = std::make_unique<BatchData>();
+		m_gpu_timer_data = std::make_unique<GpuTimerData>();
+#if UZE_GL == UZE_OPENGL33
+		// Timer queries are core since 3.3, WebGL only has them behind a disjoint query extension
+		m_gpu_timer_data->supported = glQueryCounter && glGetQueryObjectui64v;
+#endif
+		uzLog(log_renderer, Info, "GPU timer queries: {}", m_gpu_timer_data->supported ? "supported" : "not supported");
 
 		UniformBufferSpecification scene_buffer_spec;
 		scene_buffer_spec.binding = 0;
@@ -233,39 +347,65 @@ vec4 fragment(Input i)
 
 		BufferSpecification vertex_buffer_spec;
 		vertex_buffer_spec.dynamic = true;
-		vertex_buffer_spec.size = max_quad_vertices * sizeof(QuadVertex);
+		vertex_buffer_spec.size = m_spec.instanced_quads
+			? max_quads_in_one_batch * sizeof(QuadInstance) * num_quad_buffer_regions
+			: max_quad_vertices * sizeof(QuadVertex) * num_quad_buffer_regions;
+		vertex_buffer_spec.num_stream_regions = num_quad_buffer_regions;
 		m_batch_data->quad_vertex_buffer = createVertexBuffer(vertex_buffer_spec);
 
-		m_batch_data->quad_vertices_base = std::make_unique<QuadVertex[]>(max_quad_vertices);
-		u32* quad_indices = new u32[max_quad_indices];
-		u32 offset = 0;
-		for (u32 i = 0; i < max_quad_indices; i += quad_index_count)
+		if (m_spec.instanced_quads)
 		{
-			quad_indices[i + 0] = offset + 0;
-			quad_indices[i + 1] = offset + 1;
-			quad_indices[i + 2] = offset + 2;
-
-			quad_indices[i + 3] = offset + 0;
-			quad_indices[i + 4] = offset + 2;
-			quad_indices[i + 5] = offset + 3;
+			// Indices of a single quad, the shader picks corners by gl_VertexID
+			u32 quad_indices[quad_index_count] = { 0, 1, 2, 0, 2, 3 };
+			BufferSpecification index_buffer_spec;
+			index_buffer_spec.size = sizeof(quad_indices);
+			index_buffer_spec.data = quad_indices;
+			m_batch_data->quad_index_buffer = createIndexBuffer(index_buffer_spec);
+
+			VertexLayout layout;
+			layout.push<glm::vec4>(1).push<glm::vec2>(1).push<u8>(4).push<float>(1);
+			if (layout.getStride() != sizeof(QuadInstance))
+			{
+				uzLog(log_renderer, Error, "Quad instance layout stride {} doesn't match sizeof(QuadInstance) {}",
+					layout.getStride(), sizeof(QuadInstance));
+				return;
+			}
 
-			offset += quad_vertex_count;
+			m_batch_data->quad_vertex_array->addVertexBuffer(m_batch_data->quad_vertex_buffer, layout, 1);
+			m_batch_data->quad_vertex_array->setIndexBuffer(m_batch_data->quad_index_buffer);
 		}
+		else
+		{
+			u32* quad_indices = new u32[max_quad_indices];
+			u32 offset = 0;
+			for (u32 i = 0; i < max_quad_indices; i += quad_index_count)
+			{
+				quad_indices[i + 0] = offset + 0;
+				quad_indices[i + 1] = offset + 1;
+				quad_indices[i + 2] = offset + 2;
+
+				quad_indices[i + 3] = offset + 0;
+				quad_indices[i + 4] = offset + 2;
+				quad_indices[i + 5] = offset + 3;
+
+				offset += quad_vertex_count;
+			}
 
-		BufferSpecification index_buffer_spec;
-		index_buffer_spec.size = sizeof(*quad_indices) * max_quad_indices;
-		index_buffer_spec.data = quad_indices;
-		m_batch_data->quad_index_buffer = createIndexBuffer(index_buffer_spec);
-		glFlush();
-		delete[] quad_indices;
+			BufferSpecification index_buffer_spec;
+			index_buffer_spec.size = sizeof(*quad_indices) * max_quad_indices;
+			index_buffer_spec.data = quad_indices;
+			m_batch_data->quad_index_buffer = createIndexBuffer(index_buffer_spec);
+			glFlush();
+			delete[] quad_indices;
 
-		VertexLayout layout;
-		layout.push<glm::vec4>(1).push<glm::vec4>(1);
-		if (layout.getStride() != sizeof(QuadVertex))
-			uzLog(log_renderer, Warn, "layout.stride != sizeof(QuadVertex)");
+			VertexLayout layout;
+			layout.push<glm::vec4>(1).push<glm::vec4>(1);
+			if (layout.getStride() != sizeof(QuadVertex))
+				uzLog(log_renderer, Warn, "layout.stride != sizeof(QuadVertex)");
 
-		m_batch_data->quad_vertex_array->addVertexBuffer(m_batch_data->quad_vertex_buffer, layout);
-		m_batch_data->quad_vertex_array->setIndexBuffer(m_batch_data->quad_index_buffer);
+			m_batch_data->quad_vertex_array->addVertexBuffer(m_batch_data->quad_vertex_buffer, layout);
+			m_batch_data->quad_vertex_array->setIndexBuffer(m_batch_data->quad_index_buffer);
+		}
 
 		m_batch_data->quad_vertex_positions[0] = glm::vec2(-0.5f, 0.5f);
 		m_batch_data->quad_vertex_positions[1] = glm::vec2(-0.5f, -0.5f);
@@ -279,6 +419,19 @@ vec4 fragment(Input i)
 	{
 		if (!m_valid) return;
 
+		for (auto& frame : m_gpu_timer_data->frames)
+		{
+			if (!frame.queries.empty())
+				glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+		}
+
+		if (m_framebuffer)
+		{
+			glDeleteFramebuffers(1, &m_framebuffer);
+			glDeleteRenderbuffers(1, &m_color_renderbuffer);
+			glDeleteRenderbuffers(1, &m_depth_renderbuffer);
+		}
+
 		SDL_GL_DeleteContext(m_gl_context);
 		SDL_DestroyWindow(m_window);
 	}
@@ -291,10 +444,19 @@ vec4 fragment(Input i)
 
 	void Renderer::beginFrame()
 	{
+		UZE_PROFILE_SCOPE("Renderer::beginFrame");
 		m_stats.reset();
+		// Otherwise the first frame would include everything since the renderer was created
+		if (!m_frame_stats.getNumFrames())
+			m_frame_sw.reset();
+
+		resolveGpuTimers();
+		beginGpuScope("Frame");
 
-		int w, h;
-		SDL_GetWindowSize(m_window, &w, &h);
+		i32 w, h;
+		getFramebufferSize(w, h);
+		if (m_framebuffer)
+			glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
 		glViewport(0, 0, w, h);
 
 		const float aspect = static_cast<float>(w) / static_cast<float>(h);
@@ -307,9 +469,36 @@ vec4 fragment(Input i)
 
 	void Renderer::endFrame()
 	{
+		UZE_PROFILE_SCOPE("Renderer::endFrame");
 		endBatch();
-		SDL_GL_SwapWindow(m_window);
+
+		endGpuScope();
+		m_gpu_timer_data->getCurrentFrame().pending = m_gpu_timer_data->supported;
+		m_gpu_timer_data->getCurrentFrame().frame_number = m_frame_stats.getNumFrames();
+		++m_gpu_timer_data->frame_index;
+
+		if (!m_spec.headless)
+		{
+			UZE_PROFILE_SCOPE("SwapWindow");
+			const Stopwatch swap_sw;
+			SDL_GL_SwapWindow(m_window);
+			m_stats.swap_time_ms = swap_sw.getElapsedMilliseconds();
+		}
+		else
+		{
+			// Nothing is presented, commands are only submitted
+			glFlush();
+		}
 		m_stats.frame_time_ms = m_stats.m_start.getElapsedMilliseconds();
+
+		FrameTiming timing;
+		timing.frame_ms = m_frame_sw.getElapsedMilliseconds();
+		timing.swap_ms = m_stats.swap_time_ms;
+		// Isn't known yet, set by resolveGpuTimers a few frames later
+		timing.gpu_ms = 0.0;
+		timing.cpu_ms = timing.frame_ms - timing.swap_ms;
+		m_frame_stats.addFrame(timing);
+		m_frame_sw.reset();
 	}
 
 	void Renderer::bindShader(const Shader& shader)
@@ -324,10 +513,23 @@ vec4 fragment(Input i)
 		m_stats.num_draw_calls++;
 	}
 
-	void Renderer::draw(const VertexArray& vertex_array, i32 num_indices)
+	void Renderer::draw(const VertexArray& vertex_array, i32 num_indices, i32 base_vertex)
+	{
+		glBindVertexArray(vertex_array.m_handle);
+#if UZE_GL == UZE_OPENGL33
+		if (base_vertex)
+			glDrawElementsBaseVertex(GL_TRIANGLES, num_indices, GL_UNSIGNED_INT, nullptr, base_vertex);
+		else
+#endif
+			glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_INT, nullptr);
+		m_stats.num_draw_calls++;
+	}
+
+	void Renderer::drawInstanced(const VertexArray& vertex_array, i32 num_instances)
 	{
 		glBindVertexArray(vertex_array.m_handle);
-		glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_INT, nullptr);
+		glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLint>(vertex_array.getIndexBuffer()->getCount()),
+			GL_UNSIGNED_INT, nullptr, num_instances);
 		m_stats.num_draw_calls++;
 	}
 
@@ -338,6 +540,22 @@ vec4 fragment(Input i)
 
 	void Renderer::drawQuad(const glm::mat4& transform, const glm::vec4& color)
 	{
+		if (m_spec.instanced_quads)
+		{
+			if (m_batch_data->num_quad_instances >= max_quads_in_one_batch)
+				nextBatch();
+
+			auto& instance = *m_batch_data->quad_instances_ptr++;
+			instance.basis = glm::vec4(transform[0].x, transform[0].y, transform[1].x, transform[1].y);
+			instance.translation = glm::vec2(transform[3].x, transform[3].y);
+			instance.color = glm::packUnorm4x8(color);
+			instance.tex_index = 0.0f;
+
+			m_batch_data->num_quad_instances++;
+			m_stats.num_quads++;
+			return;
+		}
+
 		if (m_batch_data->quad_index_count + quad_index_count >= max_quad_indices)
 			nextBatch();
 
@@ -355,6 +573,65 @@ vec4 fragment(Input i)
 		m_stats.num_quads++;
 	}
 
+	std::vector<u8> Renderer::readPixels() const
+	{
+		i32 w, h;
+		getFramebufferSize(w, h);
+		const u64 row_size = static_cast<u64>(w) * 4;
+		std::vector<u8> pixels(row_size * static_cast<u64>(h));
+		if (pixels.empty())
+			return pixels;
+
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+		// GL rows go from the bottom up
+		std::vector<u8> row(row_size);
+		for (i32 y = 0; y < h / 2; ++y)
+		{
+			u8* top = pixels.data() + static_cast<u64>(y) * row_size;
+			u8* bottom = pixels.data() + static_cast<u64>(h - 1 - y) * row_size;
+			std::memcpy(row.data(), top, row_size);
+			std::memcpy(top, bottom, row_size);
+			std::memcpy(bottom, row.data(), row_size);
+		}
+		return pixels;
+	}
+
+	void Renderer::beginGpuScope(const char* name)
+	{
+		auto& data = *m_gpu_timer_data;
+		if (!data.supported)
+			return;
+
+		auto& frame = data.getCurrentFrame();
+		const auto depth = static_cast<u32>(data.open_scopes.size());
+		data.open_scopes.push_back(static_cast<u32>(frame.scopes.size()));
+		frame.scopes.push_back({ name, depth, data.writeTimestamp(), unfinished_scope });
+	}
+
+	void Renderer::endGpuScope()
+	{
+		auto& data = *m_gpu_timer_data;
+		if (!data.supported || data.open_scopes.empty())
+			return;
+
+		auto& frame = data.getCurrentFrame();
+		frame.scopes[data.open_scopes.back()].end_query = data.writeTimestamp();
+		data.open_scopes.pop_back();
+	}
+
+	const std::vector<GpuTiming>& Renderer::getGpuTimings() const
+	{
+		return m_gpu_timer_data->timings;
+	}
+
+	bool Renderer::isGpuTimingSupported() const
+	{
+		return m_gpu_timer_data->supported;
+	}
+
 	std::shared_ptr<Shader> Renderer::createShader(const ShaderSpecification& spec)
 	{
 		auto shader = std::shared_ptr<Shader>(new Shader(spec, *this));
@@ -448,20 +725,58 @@ vec4 fragment(Input i)
 	void Renderer::startBatch()
 	{
 		m_batch_data->quad_index_count = 0;
-		m_batch_data->quad_vertices_ptr = m_batch_data->quad_vertices_base.get();
+		m_batch_data->num_quad_instances = 0;
+		// Vertices are written straight into the vertex buffer, no copy at the end of the batch
+		void* data = m_batch_data->quad_vertex_buffer->mapRegion();
+		if (m_spec.instanced_quads)
+		{
+			m_batch_data->quad_instances_base = static_cast<QuadInstance*>(data);
+			m_batch_data->quad_instances_ptr = m_batch_data->quad_instances_base;
+		}
+		else
+		{
+			m_batch_data->quad_vertices_base = static_cast<QuadVertex*>(data);
+			m_batch_data->quad_vertices_ptr = m_batch_data->quad_vertices_base;
+		}
 	}
 
 	void Renderer::endBatch()
 	{
-		if (!m_batch_data->quad_index_count) return;
-
+		UZE_PROFILE_SCOPE("Renderer::endBatch");
 		u32 num_vertices = static_cast<u32>(static_cast<double>(m_batch_data->quad_index_count) / 1.5);
 		u32 data_size = num_vertices * sizeof(QuadVertex);
+		if (m_spec.instanced_quads)
+		{
+			num_vertices = m_batch_data->num_quad_instances * static_cast<u32>(quad_vertex_count);
+			data_size = m_batch_data->num_quad_instances * sizeof(QuadInstance);
+		}
 
-		m_batch_data->quad_vertex_buffer->updateData(m_batch_data->quad_vertices_base.get(), data_size, 0);
+		// Always unmapped, buffers can't stay mapped while drawing
+		const u64 offset = m_batch_data->quad_vertex_buffer->unmapRegion(data_size);
+		m_batch_data->quad_vertices_base = nullptr;
+		m_batch_data->quad_vertices_ptr = nullptr;
+		m_batch_data->quad_instances_base = nullptr;
+		m_batch_data->quad_instances_ptr = nullptr;
+		if (!data_size) return;
 
+		beginGpuScope("Quad batch");
 		bindShader(*m_batch_data->quad_shader);
-		draw(*m_batch_data->quad_vertex_array, static_cast<i32>(m_batch_data->quad_index_count));
+		if (m_spec.instanced_quads)
+		{
+			// Without base instance, attributes are moved to the region instead
+			if (offset != m_batch_data->quad_instance_offset)
+			{
+				m_batch_data->quad_vertex_array->setVertexBufferOffset(*m_batch_data->quad_vertex_buffer, offset);
+				m_batch_data->quad_instance_offset = offset;
+			}
+			drawInstanced(*m_batch_data->quad_vertex_array, static_cast<i32>(m_batch_data->num_quad_instances));
+		}
+		else
+		{
+			draw(*m_batch_data->quad_vertex_array, static_cast<i32>(m_batch_data->quad_index_count),
+				static_cast<i32>(offset / sizeof(QuadVertex)));
+		}
+		endGpuScope();
 		m_stats.num_vertices += num_vertices;
 	}
 
@@ -471,6 +786,85 @@ vec4 fragment(Input i)
 		startBatch();
 	}
 
+	void Renderer::resolveGpuTimers()
+	{
+		auto& data = *m_gpu_timer_data;
+		auto& frame = data.getCurrentFrame();
+		data.open_scopes.clear();
+
+#if UZE_GL == UZE_OPENGL33
+		if (frame.pending && frame.num_used_queries)
+		{
+			// Queries finish in order, so the last one being available means all of them are
+			GLint available = 0;
+			glGetQueryObjectiv(frame.queries[frame.num_used_queries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available)
+			{
+				std::array<GLuint64, 2> timestamps;
+				data.timings.clear();
+				for (const auto& scope : frame.scopes)
+				{
+					if (scope.end_query == unfinished_scope)
+						continue;
+
+					glGetQueryObjectui64v(frame.queries[scope.begin_query], GL_QUERY_RESULT, &timestamps[0]);
+					glGetQueryObjectui64v(frame.queries[scope.end_query], GL_QUERY_RESULT, &timestamps[1]);
+					const double time_ms = static_cast<double>(timestamps[1] - timestamps[0]) * 0.001 * 0.001;
+					data.timings.push_back({ scope.name, scope.depth, time_ms });
+				}
+
+				if (!data.timings.empty())
+					m_frame_stats.setGpuTime(frame.frame_number, data.timings.front().time_ms);
+			}
+			else
+			{
+				// Reading now would stall, these results are lost instead
+				uzLogLimited(log_renderer, Warn, 1, "GPU timer queries weren't finished after {} frames",
+					gpu_timer_latency);
+			}
+		}
+#endif
+
+		m_stats.gpu_time_ms = !data.timings.empty() ? data.timings.front().time_ms : 0.0;
+
+		frame.pending = false;
+		frame.num_used_queries = 0;
+		frame.scopes.clear();
+	}
+
+	bool Renderer::createFramebuffer()
+	{
+		const auto width = static_cast<GLsizei>(m_spec.width);
+		const auto height = static_cast<GLsizei>(m_spec.height);
+
+		glGenRenderbuffers(1, &m_color_renderbuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, m_color_renderbuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+		glGenRenderbuffers(1, &m_depth_renderbuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, m_depth_renderbuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		glGenFramebuffers(1, &m_framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_color_renderbuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depth_renderbuffer);
+
+		return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	}
+
+	void Renderer::getFramebufferSize(i32& width, i32& height) const
+	{
+		if (m_spec.headless)
+		{
+			width = static_cast<i32>(m_spec.width);
+			height = static_cast<i32>(m_spec.height);
+		}
+		else
+			SDL_GetWindowSize(m_window, &width, &height);
+	}
+
 	void Renderer::registerShaderPreprocessorImpl(std::unique_ptr<ShaderPreprocessor> pp)
 	{
 		auto type_name = pp->getTypeName();
@@ -44,6 +44,42 @@ void main()
 	tex_index_ = a_position_tex_index_tiling.z;
 	tiling_ = a_position_tex_index_tiling.w;
 }
+)";
+
+	// One instance per quad, corners are expanded from the 2x3 transform
+	static constexpr const char* batch_instanced_vertex_shader = R"(
+precision mediump float;
+
+layout (location = 0) in vec4 a_basis;
+layout (location = 1) in vec2 a_translation;
+layout (location = 2) in vec4 a_color;
+layout (location = 3) in float a_tex_index;
+
+layout (std140) uniform Scene
+{
+	mat4 view_projection;
+};
+
+out vec2 position_;
+out vec4 color_;
+out vec2 tex_coord_;
+out float tex_index_;
+out float tiling_;
+
+const vec2 quad_corners[4] = vec2[] (vec2(-0.5, 0.5), vec2(-0.5, -0.5), vec2(0.5, -0.5), vec2(0.5, 0.5));
+const vec2 quad_tex_coords[4] = vec2[] (vec2(0, 1), vec2(0, 0), vec2(1, 0), vec2(1, 1));
+
+void main()
+{
+	vec2 corner = quad_corners[gl_VertexID];
+	tex_coord_ = quad_tex_coords[gl_VertexID];
+	position_ = a_basis.xy * corner.x + a_basis.zw * corner.y + a_translation;
+
+	gl_Position = view_projection * vec4(position_, 0.0, 1.0);
+	color_ = a_color;
+	tex_index_ = a_tex_index;
+	tiling_ = 1.0;
+}
 )";
 
 	RawShaderSpecification::RawShaderSpecification(std::string_view vertex_source_,
@@ -177,7 +213,7 @@ vec4 platformFixColor(vec4 c)
 		}
 
 
-		vertex = batch_vertex_shader;
+		vertex = renderer.getSpecification().instanced_quads ? batch_instanced_vertex_shader : batch_vertex_shader;
 		std::stringstream ss;
 		ss << fragment_source << shader;
 		fragment = ss.str();
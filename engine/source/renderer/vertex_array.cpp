@@ -15,22 +15,46 @@ namespace uze
 			glDeleteVertexArrays(1, &m_handle);
 	}
 
-	void VertexArray::addVertexBuffer(const std::shared_ptr<VertexBuffer>& buffer, const VertexLayout& layout)
+	void VertexArray::addVertexBuffer(const std::shared_ptr<VertexBuffer>& buffer, const VertexLayout& layout, u32 divisor)
 	{
 		glBindVertexArray(m_handle);
 		buffer->bind();
+		m_bindings.push_back({ buffer.get(), layout, m_attribute_index });
 
 		const auto& elements = layout.getElements();
 		for (const auto& element : elements)
 		{
 			glEnableVertexAttribArray(m_attribute_index);
-			glVertexAttribPointer(m_attribute_index++, element.count, element.type,
+			glVertexAttribPointer(m_attribute_index, element.count, element.type,
 				element.normalized, layout.getStride(), reinterpret_cast<const void*>(element.offset));
+			if (divisor)
+				glVertexAttribDivisor(m_attribute_index, divisor);
+			++m_attribute_index;
 
 			m_vertex_buffers.push_back(buffer);
 		}
 	}
 
+	void VertexArray::setVertexBufferOffset(VertexBuffer& buffer, u64 offset)
+	{
+		for (const auto& binding : m_bindings)
+		{
+			if (binding.buffer != &buffer)
+				continue;
+
+			glBindVertexArray(m_handle);
+			if (!buffer.isBound())
+				buffer.bind();
+
+			u32 attribute = binding.first_attribute;
+			for (const auto& element : binding.layout.getElements())
+			{
+				glVertexAttribPointer(attribute++, element.count, element.type, element.normalized,
+					binding.layout.getStride(), reinterpret_cast<const void*>(element.offset + offset));
+			}
+		}
+	}
+
 	void VertexArray::setIndexBuffer(const std::shared_ptr<IndexBuffer>& buffer)
 	{
 		glBindVertexArray(m_handle);
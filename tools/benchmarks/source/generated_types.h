@@ -0,0 +1,21 @@
+#pragma once
+
+#include "uze/core/type_info.h"
+
+// Declares and reflects uze::benchmark::generated::Type<n>. CMake generates sources with
+// UZE_BENCHMARK_NUM_TYPES of them for the registry startup benchmark
+#define UZE_BENCHMARK_TYPE(n) \
+	namespace uze::benchmark::generated \
+	{ \
+		uzclass Type##n : public Object \
+		{ \
+			UZE_OBJECT(Type##n) \
+			serialize_field float value{ 0.0f }; \
+			serialize_field i32 count{ 0 }; \
+		}; \
+	} \
+	UZE_REFLECT(uze::benchmark::generated::Type##n, \
+		type(uze::benchmark::generated::Type##n, bases<uze::Object>), \
+		field(value), \
+		field(count) \
+	)
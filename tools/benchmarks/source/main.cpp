@@ -0,0 +1,674 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fmt/format.h>
+#include <refl.hpp>
+#include "uze/log.h"
+#include "uze/core/buffer.h"
+#include "uze/core/compact_serialize.h"
+#include "uze/core/job_system.h"
+#include "uze/core/random.h"
+#include "uze/core/tagged_serialize.h"
+#include "uze/core/type_info.h"
+#include "uze/renderer/renderer.h"
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// Microbenchmarks of engine core primitives.
+//
+//	uze_benchmarks [--filter <text>] [--repetitions <n>] [--min-time-ms <ms>]
+//		[--json <file>] [--baseline <file>]
+//
+// Every benchmark is calibrated to run at least min-time-ms per sample and is then sampled
+// `repetitions` times. Reported times are per operation, the median is the main number since it
+// isn't skewed by the occasional preempted sample. With --baseline, medians are compared to a
+// previous --json output and changes larger than the noise of both runs are marked.
+// registry/init_<n>_types can only be measured once per process, so it's a single sample.
+// The job queue is internal to the job system, push and pop are measured together with
+// submitting and executing a job by job_system/submit_execute. ConcurrentQueue isn't used by anything
+// and doesn't compile when instantiated, so it has no benchmark
+
+namespace uze
+{
+
+	uzclass BenchmarkObject : public Object
+	{
+		UZE_OBJECT(BenchmarkObject)
+
+	public:
+
+		serialize_field float value{ 0.0f };
+
+	};
+
+}
+
+UZE_REFLECT(uze::BenchmarkObject,
+	type(uze::BenchmarkObject, bases<uze::Object>),
+	field(value)
+)
+
+namespace uze::benchmark
+{
+
+	static constexpr LogCategory log_benchmark { "Benchmark" };
+
+	template <class T>
+	inline void doNotOptimize(const T& value)
+	{
+		// The value's address escapes, so it has to be computed and stored
+#if defined(_MSC_VER) && !defined(__clang__)
+		static const volatile void* s_sink;
+		s_sink = &value;
+		_ReadWriteBarrier();
+#else
+		asm volatile("" : : "g"(&value) : "memory");
+#endif
+	}
+
+	class NullStreamBuffer final : public std::streambuf
+	{
+	protected:
+
+		int overflow(int c) override { return c; }
+		std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+	};
+
+	struct Benchmark
+	{
+		std::string name;
+		// Runs the measured operation `iterations` times
+		std::function<void(u64 iterations)> run;
+		// For throughput, zero if it doesn't make sense
+		u64 bytes_per_op{ 0 };
+		// Called around every sample, outside of the measured time
+		std::function<void()> before;
+		std::function<void()> after;
+		// Can only run once per process, measured as a single sample without calibration
+		bool one_shot{ false };
+	};
+
+	struct Result
+	{
+		std::string name;
+		u64 iterations{ 0 };
+		u64 bytes_per_op{ 0 };
+		std::vector<double> samples_ns;
+		double median_ns{ 0.0 };
+		double mean_ns{ 0.0 };
+		double stddev_ns{ 0.0 };
+		double min_ns{ 0.0 };
+		double max_ns{ 0.0 };
+		// Half-width of the 95% confidence interval of the median
+		double ci95_ns{ 0.0 };
+	};
+
+	struct Options
+	{
+		std::string filter;
+		u64 repetitions{ 15 };
+		double min_time_ms{ 20.0 };
+		std::string json_file;
+		std::string baseline_file;
+	};
+
+	static double measure(const Benchmark& benchmark, u64 iterations)
+	{
+		if (benchmark.before)
+			benchmark.before();
+
+		const auto start = std::chrono::steady_clock::now();
+		benchmark.run(iterations);
+		const auto end = std::chrono::steady_clock::now();
+
+		if (benchmark.after)
+			benchmark.after();
+		return std::chrono::duration<double, std::nano>(end - start).count();
+	}
+
+	static Result runBenchmark(const Benchmark& benchmark, const Options& options)
+	{
+		// Grows the number of iterations until a sample is long enough for the clock resolution
+		// and scheduler noise not to matter, which also warms up caches and branch predictors
+		const double min_time_ns = options.min_time_ms * 1e6;
+		u64 iterations = 1;
+		while (!benchmark.one_shot)
+		{
+			const double time_ns = measure(benchmark, iterations);
+			if (time_ns >= min_time_ns)
+				break;
+
+			const double scale = time_ns > 0.0 ? min_time_ns / time_ns * 1.2 : 10.0;
+			iterations = std::max(iterations + 1, static_cast<u64>(static_cast<double>(iterations) * std::min(scale, 10.0)));
+		}
+
+		Result result;
+		result.name = benchmark.name;
+		result.iterations = iterations;
+		result.bytes_per_op = benchmark.bytes_per_op;
+		const u64 repetitions = benchmark.one_shot ? 1 : options.repetitions;
+		for (u64 n = 0; n < repetitions; ++n)
+			result.samples_ns.push_back(measure(benchmark, iterations) / static_cast<double>(iterations));
+
+		auto sorted = result.samples_ns;
+		std::sort(sorted.begin(), sorted.end());
+		const u64 count = sorted.size();
+		result.min_ns = sorted.front();
+		result.max_ns = sorted.back();
+		result.median_ns = count % 2 ? sorted[count / 2] : (sorted[count / 2 - 1] + sorted[count / 2]) * 0.5;
+
+		double sum = 0.0;
+		for (const double sample : sorted)
+			sum += sample;
+		result.mean_ns = sum / static_cast<double>(count);
+
+		double squares = 0.0;
+		for (const double sample : sorted)
+			squares += (sample - result.mean_ns) * (sample - result.mean_ns);
+		result.stddev_ns = count > 1 ? std::sqrt(squares / static_cast<double>(count - 1)) : 0.0;
+
+		// Distribution-free interval of the median from order statistics, samples are rarely normal
+		const double half_width = 0.98 * std::sqrt(static_cast<double>(count));
+		const auto low = static_cast<u64>(std::max(0.0, std::floor(static_cast<double>(count) * 0.5 - half_width)));
+		const auto high = static_cast<u64>(std::min(static_cast<double>(count - 1),
+			std::ceil(static_cast<double>(count) * 0.5 + half_width)));
+		result.ci95_ns = (sorted[high] - sorted[low]) * 0.5;
+
+		return result;
+	}
+
+	static std::string formatTime(double ns)
+	{
+		if (ns < 1e3) return fmt::format("{:.2f} ns", ns);
+		if (ns < 1e6) return fmt::format("{:.2f} us", ns * 1e-3);
+		return fmt::format("{:.2f} ms", ns * 1e-6);
+	}
+
+	static bool writeJson(const std::vector<Result>& results, const Options& options, std::ostream& out)
+	{
+		fmt::memory_buffer buffer;
+		auto it = std::back_inserter(buffer);
+		fmt::format_to(it, "{{\n\"repetitions\": {},\n\"min_time_ms\": {},\n\"benchmarks\": [\n",
+			options.repetitions, options.min_time_ms);
+		for (u64 n = 0; n < results.size(); ++n)
+		{
+			const auto& result = results[n];
+			// One benchmark per line, readBaseline relies on it
+			fmt::format_to(it, "{{\"name\": \"{}\", \"iterations\": {}, \"median_ns\": {:.4f}, \"mean_ns\": {:.4f}, "
+				"\"stddev_ns\": {:.4f}, \"min_ns\": {:.4f}, \"max_ns\": {:.4f}, \"ci95_ns\": {:.4f}, \"bytes_per_second\": {:.0f}}}{}\n",
+				result.name, result.iterations, result.median_ns, result.mean_ns, result.stddev_ns, result.min_ns,
+				result.max_ns, result.ci95_ns, result.bytes_per_op ? result.bytes_per_op * 1e9 / result.median_ns : 0.0,
+				n + 1 < results.size() ? "," : "");
+		}
+		fmt::format_to(it, "]\n}}\n");
+
+		out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		return out.good();
+	}
+
+	struct BaselineEntry
+	{
+		double median_ns;
+		double ci95_ns;
+	};
+
+	static double findNumber(std::string_view line, std::string_view key)
+	{
+		const auto pos = line.find(fmt::format("\"{}\": ", key));
+		if (pos == std::string_view::npos)
+			return 0.0;
+		return std::strtod(std::string(line.substr(pos + key.size() + 4)).c_str(), nullptr);
+	}
+
+	static std::unordered_map<std::string, BaselineEntry> readBaseline(std::istream& in)
+	{
+		std::unordered_map<std::string, BaselineEntry> baseline;
+		constexpr std::string_view name_key = "{\"name\": \"";
+		std::string line;
+		while (std::getline(in, line))
+		{
+			const auto pos = line.find(name_key);
+			if (pos == std::string::npos)
+				continue;
+
+			const auto name_start = pos + name_key.size();
+			const auto name_end = line.find('"', name_start);
+			baseline[line.substr(name_start, name_end - name_start)] =
+				{ findNumber(line, "median_ns"), findNumber(line, "ci95_ns") };
+		}
+		return baseline;
+	}
+
+	static void printResult(const Result& result, const std::unordered_map<std::string, BaselineEntry>& baseline)
+	{
+		std::string line = fmt::format("{:<40} {:>12} +- {:<10}", result.name, formatTime(result.median_ns),
+			formatTime(result.ci95_ns));
+		if (result.bytes_per_op)
+			line += fmt::format(" {:>9.1f} MB/s", result.bytes_per_op * 1e3 / result.median_ns);
+
+		if (const auto it = baseline.find(result.name); it != baseline.end() && it->second.median_ns > 0.0)
+		{
+			const double change = (result.median_ns / it->second.median_ns - 1.0) * 100.0;
+			// Overlapping intervals are treated as noise
+			const bool significant = std::abs(result.median_ns - it->second.median_ns) > result.ci95_ns + it->second.ci95_ns;
+			line += fmt::format("  {:+.1f}%{}", change, significant ? (change < 0.0 ? " faster" : " SLOWER") : "");
+		}
+		std::cout << line << std::endl;
+	}
+
+	static std::vector<Benchmark> makeJobSystemBenchmarks()
+	{
+		std::vector<Benchmark> benchmarks;
+
+		// Queue push and pop plus execution. Submitted and waited for in groups,
+		// so the queue doesn't grow with the number of iterations
+		auto jobs = std::make_shared<std::vector<std::unique_ptr<Job>>>();
+		for (u64 n = 0; n < 256; ++n)
+			jobs->push_back(std::make_unique<Job>([] { return JobResult::Success; }));
+
+		benchmarks.push_back({ "job_system/submit_execute", [jobs](u64 iterations)
+		{
+			for (u64 done = 0; done < iterations;)
+			{
+				const u64 count = std::min<u64>(jobs->size(), iterations - done);
+				for (u64 n = 0; n < count; ++n)
+					job_system::submit(*(*jobs)[n]);
+				for (u64 n = 0; n < count; ++n)
+					(*jobs)[n]->wait();
+				done += count;
+			}
+		} });
+
+		benchmarks.push_back({ "job_system/parallel_for_1024", [](u64 iterations)
+		{
+			std::vector<u64> values(1024);
+			for (u64 n = 0; n < iterations; ++n)
+				job_system::parallelFor(values.size(), [&](u64 index) { values[index] += index; });
+			doNotOptimize(values.data());
+		} });
+
+		return benchmarks;
+	}
+
+	static std::vector<Benchmark> makeBufferBenchmarks()
+	{
+		std::vector<Benchmark> benchmarks;
+		for (const u64 size : { 64ull, 4096ull, 1024ull * 1024ull })
+		{
+			benchmarks.push_back({ fmt::format("buffer/allocate_{}", size), [size](u64 iterations)
+			{
+				for (u64 n = 0; n < iterations; ++n)
+				{
+					Buffer buffer(size);
+					doNotOptimize(buffer.data);
+					buffer.release();
+				}
+			} });
+		}
+		return benchmarks;
+	}
+
+	static std::vector<Benchmark> makeSerializerBenchmarks()
+	{
+		std::vector<Benchmark> benchmarks;
+
+		auto entity = std::make_shared<EntityTest>();
+		entity->name = "Benchmark entity";
+		entity->health = 100;
+		entity->x = 1.5f;
+		entity->y = -2.0f;
+		for (i8 n = 0; n < 64; ++n)
+			entity->indices.push_back(n);
+
+		auto values = std::make_shared<std::vector<u32>>();
+		for (u32 n = 0; n < 1024; ++n)
+			values->push_back(n % 300);
+
+		// Measures serializing one object into a stream which is rewound every time
+		const auto addSerializer = [&](std::string name, auto serialize)
+		{
+			std::ostringstream out;
+			serialize(out);
+			const u64 size = out.str().size();
+
+			benchmarks.push_back({ "serialize/" + name, [serialize](u64 iterations)
+			{
+				std::ostringstream out;
+				for (u64 n = 0; n < iterations; ++n)
+				{
+					out.seekp(0);
+					serialize(out);
+				}
+				doNotOptimize(out);
+			}, size });
+		};
+
+		const auto addDeserializer = [&](std::string name, auto serialize, auto deserialize)
+		{
+			std::ostringstream out;
+			serialize(out);
+			const auto data = std::make_shared<std::string>(out.str());
+
+			benchmarks.push_back({ "deserialize/" + name, [data, deserialize](u64 iterations)
+			{
+				std::istringstream in(*data);
+				for (u64 n = 0; n < iterations; ++n)
+				{
+					in.clear();
+					in.seekg(0);
+					deserialize(in);
+				}
+			}, data->size() });
+		};
+
+		const auto binary = [entity](std::ostream& o) { BinarySerializer<EntityTest>{}(o, *entity); };
+		const auto tagged = [entity](std::ostream& o) { TaggedBinarySerializer<EntityTest>{}(o, *entity); };
+		const auto binary_values = [values](std::ostream& o) { BinarySerializer<std::vector<u32>>{}(o, *values); };
+		const auto compact_values = [values](std::ostream& o) { CompactBinarySerializer<std::vector<u32>>{}(o, *values); };
+
+		addSerializer("binary_entity", binary);
+		addSerializer("tagged_entity", tagged);
+		addSerializer("binary_vector_u32", binary_values);
+		addSerializer("compact_vector_u32", compact_values);
+
+		addDeserializer("binary_entity", binary, [](std::istream& i)
+		{
+			EntityTest entity;
+			BinaryDeserializer<EntityTest>{}(i, entity);
+			doNotOptimize(entity);
+		});
+		addDeserializer("tagged_entity", tagged, [](std::istream& i)
+		{
+			EntityTest entity;
+			TaggedBinaryDeserializer<EntityTest>{}(i, entity);
+			doNotOptimize(entity);
+		});
+		addDeserializer("compact_vector_u32", compact_values, [](std::istream& i)
+		{
+			std::vector<u32> values;
+			CompactBinaryDeserializer<std::vector<u32>>{}(i, values);
+			doNotOptimize(values.data());
+		});
+
+		return benchmarks;
+	}
+
+	static std::vector<Benchmark> makeRegistryBenchmarks()
+	{
+		std::vector<Benchmark> benchmarks;
+
+		benchmarks.push_back({ "registry/get_type_info_by_id", [](u64 iterations)
+		{
+			const TypeId id = type_id_v<BenchmarkObject>;
+			for (u64 n = 0; n < iterations; ++n)
+				doNotOptimize(Registry::getTypeInfo(id));
+		} });
+
+		benchmarks.push_back({ "registry/get_type_info_by_name", [](u64 iterations)
+		{
+			const std::string name(Registry::getTypeInfo<BenchmarkObject>()->name);
+			for (u64 n = 0; n < iterations; ++n)
+				doNotOptimize(Registry::getTypeInfo(name));
+		} });
+
+		benchmarks.push_back({ "registry/cast", [](u64 iterations)
+		{
+			BenchmarkObject object;
+			Object* base = &object;
+			doNotOptimize(base);
+			for (u64 n = 0; n < iterations; ++n)
+				doNotOptimize(cast<BenchmarkObject>(base));
+		} });
+
+		return benchmarks;
+	}
+
+	static std::vector<Benchmark> makeRandomBenchmarks()
+	{
+		std::vector<Benchmark> benchmarks;
+
+		benchmarks.push_back({ "random/next_float", [](u64 iterations)
+		{
+			Random random(1);
+			for (u64 n = 0; n < iterations; ++n)
+				doNotOptimize(random.nextFloat());
+		} });
+
+		benchmarks.push_back({ "random/compact_next_float", [](u64 iterations)
+		{
+			CompactRandom random(1);
+			for (u64 n = 0; n < iterations; ++n)
+				doNotOptimize(random.nextFloat());
+		} });
+
+		benchmarks.push_back({ "random/next_int_range", [](u64 iterations)
+		{
+			Random random(1);
+			for (u64 n = 0; n < iterations; ++n)
+				doNotOptimize(random.next(-10, 12));
+		} });
+
+		// Reference point, what Random used to be built on
+		benchmarks.push_back({ "random/std_mt19937_float", [](u64 iterations)
+		{
+			std::mt19937 generator(1);
+			std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+			for (u64 n = 0; n < iterations; ++n)
+				doNotOptimize(distribution(generator));
+		} });
+
+		benchmarks.push_back({ "random/fill_uniform_1024", [](u64 iterations)
+		{
+			std::vector<float> values(1024);
+			for (u64 n = 0; n < iterations; ++n)
+			{
+				random_batch::fillUniform(n, values.data(), values.size(), 0.0f, 1.0f);
+				doNotOptimize(values.data());
+			}
+		}, 1024 * sizeof(float) });
+
+		benchmarks.push_back({ "random/fill_gaussian_1024", [](u64 iterations)
+		{
+			std::vector<float> values(1024);
+			for (u64 n = 0; n < iterations; ++n)
+			{
+				random_batch::fillGaussian(n, values.data(), values.size(), 0.0f, 1.0f);
+				doNotOptimize(values.data());
+			}
+		}, 1024 * sizeof(float) });
+
+		benchmarks.push_back({ "random/fill_in_unit_disc_1024", [](u64 iterations)
+		{
+			std::vector<glm::vec2> points(1024);
+			for (u64 n = 0; n < iterations; ++n)
+			{
+				random_batch::fillInUnitDisc(n, points.data(), points.size());
+				doNotOptimize(points.data());
+			}
+		}, 1024 * sizeof(glm::vec2) });
+
+		benchmarks.push_back({ "random/fill_on_unit_sphere_1024", [](u64 iterations)
+		{
+			std::vector<glm::vec3> points(1024);
+			for (u64 n = 0; n < iterations; ++n)
+			{
+				random_batch::fillOnUnitSphere(n, points.data(), points.size());
+				doNotOptimize(points.data());
+			}
+		}, 1024 * sizeof(glm::vec3) });
+
+		return benchmarks;
+	}
+
+	static std::vector<Benchmark> makeLogBenchmarks()
+	{
+		std::vector<Benchmark> benchmarks;
+
+		benchmarks.push_back({ "log/disabled", [](u64 iterations)
+		{
+			setLogLevel(log_benchmark.name, LL_Warn);
+			for (u64 n = 0; n < iterations; ++n)
+				uzLog(log_benchmark, Info, "Value {}", n);
+			resetLogLevel(log_benchmark.name);
+		} });
+
+		// Sustained rate, the caller blocks while the logging thread catches up and waits for the rest
+		// at the end. Starting and stopping the logging thread isn't measured
+		benchmarks.push_back({ "log/async_text", [](u64 iterations)
+		{
+			for (u64 n = 0; n < iterations; ++n)
+				uzLog(log_benchmark, Info, "Value {}, name {}", n, "benchmark");
+			flushLog();
+		}, 0, [] { startAsyncLogging(LogOverflowPolicy::Block, 1024 * 1024); }, [] { stopAsyncLogging(); } });
+
+		static NullStreamBuffer s_null_buffer;
+		static std::ostream s_null(&s_null_buffer);
+		benchmarks.push_back({ "log/async_binary", [](u64 iterations)
+		{
+			for (u64 n = 0; n < iterations; ++n)
+				uzLogBinary(log_benchmark, Info, "Value {}, name {}", n, "benchmark");
+			flushLog();
+		}, 0, []
+		{
+			initBinaryLogging(&s_null);
+			startAsyncLogging(LogOverflowPolicy::Block, 1024 * 1024);
+		}, []
+		{
+			stopAsyncLogging();
+			initBinaryLogging(nullptr);
+		} });
+
+		return benchmarks;
+	}
+
+	static std::vector<Benchmark> makeRendererBenchmarks(const std::shared_ptr<Renderer>& renderer)
+	{
+		std::vector<Benchmark> benchmarks;
+		if (!renderer->isValid())
+		{
+			uzLog(log_benchmark, Warn, "Renderer isn't available, skipping renderer benchmarks");
+			return benchmarks;
+		}
+
+		// CPU side of batching, full batches are still flushed to the GPU. Swapping isn't measured
+		benchmarks.push_back({ "renderer/draw_quad", [renderer](u64 iterations)
+		{
+			for (u64 n = 0; n < iterations; ++n)
+				renderer->drawQuad(glm::vec2(static_cast<float>(n % 100) * 0.01f, 0.0f), glm::vec4(1.0f));
+		}, 0, [renderer] { renderer->beginFrame(); }, [renderer] { renderer->endFrame(); } });
+
+		return benchmarks;
+	}
+
+	static bool parseOptions(int argc, char** argv, Options& options)
+	{
+		for (int n = 1; n < argc; ++n)
+		{
+			const std::string_view arg = argv[n];
+			const bool has_value = n + 1 < argc;
+			if (arg == "--filter" && has_value)
+				options.filter = argv[++n];
+			else if (arg == "--repetitions" && has_value)
+				options.repetitions = std::max<u64>(std::strtoull(argv[++n], nullptr, 10), 1);
+			else if (arg == "--min-time-ms" && has_value)
+				options.min_time_ms = std::strtod(argv[++n], nullptr);
+			else if (arg == "--json" && has_value)
+				options.json_file = argv[++n];
+			else if (arg == "--baseline" && has_value)
+				options.baseline_file = argv[++n];
+			else
+				return false;
+		}
+		return true;
+	}
+
+}
+
+int main(int argc, char** argv)
+{
+	using namespace uze;
+	using namespace uze::benchmark;
+
+	Options options;
+	if (!parseOptions(argc, argv, options))
+	{
+		std::cerr << "Usage: uze_benchmarks [--filter <text>] [--repetitions <n>] [--min-time-ms <ms>]"
+			" [--json <file>] [--baseline <file>]\n";
+		return 1;
+	}
+
+	// Engine messages would be mixed with the results and skew the logging benchmarks
+	NullStreamBuffer null_buffer;
+	std::ostream null_stream(&null_buffer);
+	initLogging(null_stream);
+
+	std::unordered_map<std::string, BaselineEntry> baseline;
+	if (!options.baseline_file.empty())
+	{
+		std::ifstream in(options.baseline_file);
+		if (!in.is_open())
+		{
+			std::cerr << "Cannot open `" << options.baseline_file << "`\n";
+			return 1;
+		}
+		baseline = readBaseline(in);
+	}
+
+	// Startup of the registry with UZE_BENCHMARK_NUM_TYPES generated types. Types are frozen only once
+	// per process, so it runs before everything else and is a single sample
+	std::vector<Result> results;
+	const Benchmark registry_init{ fmt::format("registry/init_{}_types", UZE_BENCHMARK_NUM_TYPES),
+		[](u64) { Registry::init(); }, 0, {}, {}, true };
+	if (registry_init.name.find(options.filter) != std::string::npos)
+	{
+		results.push_back(runBenchmark(registry_init, options));
+		printResult(results.back(), baseline);
+	}
+	Registry::init();
+
+	job_system::init();
+	RendererSpecification renderer_spec;
+	renderer_spec.headless = true;
+	const auto renderer = std::make_shared<Renderer>(renderer_spec);
+
+	std::vector<Benchmark> benchmarks;
+	for (auto group : { makeJobSystemBenchmarks(), makeBufferBenchmarks(), makeSerializerBenchmarks(),
+		makeRegistryBenchmarks(), makeRandomBenchmarks(), makeLogBenchmarks(), makeRendererBenchmarks(renderer) })
+	{
+		for (auto& benchmark : group)
+			benchmarks.push_back(std::move(benchmark));
+	}
+
+	for (const auto& benchmark : benchmarks)
+	{
+		if (benchmark.name.find(options.filter) == std::string::npos)
+			continue;
+
+		results.push_back(runBenchmark(benchmark, options));
+		printResult(results.back(), baseline);
+	}
+
+	job_system::deinit();
+
+	if (!options.json_file.empty())
+	{
+		std::ofstream out(options.json_file);
+		if (!writeJson(results, options, out))
+		{
+			std::cerr << "Cannot write `" << options.json_file << "`\n";
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,39 @@
+#include <fstream>
+#include <iostream>
+#include "uze/log.h"
+
+// Formats a log written with uze::initBinaryLogging as text
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: log_decoder <binary log> [output file]\n";
+		return 1;
+	}
+
+	std::ifstream in(argv[1], std::ios::binary);
+	if (!in.is_open())
+	{
+		std::cerr << "Cannot open `" << argv[1] << "`\n";
+		return 1;
+	}
+
+	std::ofstream file;
+	if (argc > 2)
+	{
+		file.open(argv[2]);
+		if (!file.is_open())
+		{
+			std::cerr << "Cannot open `" << argv[2] << "`\n";
+			return 1;
+		}
+	}
+
+	if (!uze::decodeBinaryLog(in, argc > 2 ? file : std::cout))
+	{
+		std::cerr << "`" << argv[1] << "` isn't a binary log or is truncated\n";
+		return 1;
+	}
+
+	return 0;
+}